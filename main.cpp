@@ -1,923 +1,4102 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <new>
 #include <string>
+#include <tuple>
+#include <utility>
 #include <array>
-#include <set>
-#include <list>
+#include <atomic>
+#include <cstddef>
+#include <deque>
 #include <map>
+#include <mutex>
+#include <thread>
 #include <vector>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#endif
+
 using namespace std;
 
 namespace SpringChallenge2023
 {
 
-struct Cell
+// reads input by large blocks into fixed buffer and parses integers by hand;
+// read(2) returns as soon as any data is available, so line by line input doesn't block it
+struct InputReader
 {
-    enum Type
-    {
-        Nothing,
-        Egg,
-        Crystal,
-    };
+    static constexpr size_t kBufferSize = 1 << 16;
 
-    Type type;
-    int initialResources; //  the amount of crystal/egg here
-    std::array<int, 6> neighArr;
+    int fd{ 0 };
+    char buffer[kBufferSize];
+    size_t pos{ 0 };
+    size_t len{ 0 };
+    bool eof{ false };
+    // some readInt() met the end of input before any digit, so the data read is truncated;
+    // the last value may end right at the end of input without a newline, that isn't truncation
+    bool isTruncated{ false };
 
-    int curResources;
-    int myAnts;
-    int oppAnts;
+    InputReader(int fd = 0):
+        fd{ fd } {}
 
-    int colonyId;
+    bool refill()
+    {
+        pos = 0;
+#if defined(__unix__) || defined(__APPLE__)
+        ssize_t readNb;
+        do
+        {
+            readNb = ::read(fd, buffer, kBufferSize);
+        } while (readNb < 0 && errno == EINTR);
+        len = readNb > 0 ? size_t(readNb) : 0;
+#else
+        // fallback without read(2): stdio line by line
+        len = std::fgets(buffer, int(kBufferSize), stdin) ? std::strlen(buffer) : 0;
+#endif
+        eof = len == 0;
+        return !eof;
+    }
 
-    void readInitState()
+    // blocks until some input is available, false on the end of input
+    bool waitInput()
     {
-        int cellType;
-        cin >> cellType >> initialResources;
-        type = static_cast<Cell::Type>(cellType);
-        for (int nCnt = 0; nCnt < neighArr.size(); nCnt++)
+        return pos < len || refill();
+    }
+
+    int nextChar()
+    {
+        if (pos == len && !refill())
         {
-            cin >> neighArr[nCnt];
+            return -1;
         }
+        return buffer[pos++];
     }
 
-    void readTurnState()
+    // returns 0 on the end of input
+    int readInt()
     {
-        cin >> curResources >> myAnts >> oppAnts;
-        cin.ignore();
+        int c = nextChar();
+        while (c != -1 && c != '-' && (c < '0' || c > '9'))
+        {
+            c = nextChar();
+        }
+        if (c == -1)
+        {
+            isTruncated = true;
+            return 0;
+        }
+
+        const bool isNegative = c == '-';
+        if (isNegative)
+        {
+            c = nextChar();
+        }
+
+        int value = 0;
+        while (c >= '0' && c <= '9')
+        {
+            value = value * 10 + (c - '0');
+            c = nextChar();
+        }
+        return isNegative ? -value : value;
     }
 };
 
-struct Action
+struct Cell
 {
-    Action() = default;
-    virtual std::string stringify()
+    enum Type
     {
-        return "WAIT;";
+        Nothing,
+        Egg,
+        Crystal,
     };
 };
-struct BeaconAction: public Action
-{
-    int index, strength;
-    BeaconAction(int index, int strength):
-        index{ index }, strength{ strength } {}
-    std::string stringify() final
-    {
-        return "BEACON "
-                + std::to_string(index) + " "
-                + std::to_string(strength) + ";";
-    }
-};
-struct LineAction: public Action
+
+// capacity of storage which is sized at runtime, for maps bigger than any fixed capacity
+constexpr int kDynamicCapacity = 0;
+
+// std::array with a compile-time capacity and the part of std::vector interface which the cells
+// arrays use; size never exceeds Capacity, the caller picks the capacity which fits the map
+template <class T, int Capacity>
+class BoundedVector
 {
-    int index1, index2, strength;
-    LineAction(int index1, int index2, int strength) :
-        index1{ index1 }, index2{ index2 }, strength{ strength } {}
-    std::string stringify() final
+public:
+    void assign(size_t size, const T& value)
     {
-        return "LINE "
-                + std::to_string(index1) + " "
-                + std::to_string(index2) + " "
-                + std::to_string(strength) + ";";
+        size_ = size;
+        std::fill(values_.begin(), values_.begin() + size, value);
     }
-};
-struct MessageAction: public Action
-{
-    std::string message;
-    MessageAction(const std::string& message):
-        message{message} {}
-    std::string stringify() final
+
+    void resize(size_t size)
     {
-        return "MESSAGE " + message + ";";
+        if (size > size_)
+        {
+            std::fill(values_.begin() + size_, values_.begin() + size, T());
+        }
+        size_ = size;
     }
-};
-
-struct Field
-{
-    int numberOfCells;
-    std::vector<Cell> cells;
-    int numberOfBases;
-    std::vector<int> friendlyBases;
-    std::vector<int> opponentBases;
-
-    int maxFieldDist{ 0 };
-
-    // synthetic
-    std::set<int> crystalCells;
-    std::set<int> eggsCells;
-
-    int totalCrystalsNb{ 0 };
-    int totalEggsNb{ 0 };
 
-    int onTurnMapCrystalsNb{ 0 };
-    int onTurnMapEggsNb{ 0 };
+    void push_back(const T& value) { values_[size_++] = value; }
+    void clear() { size_ = 0; }
+    bool empty() const { return size_ == 0; }
+    size_t size() const { return size_; }
 
-    float crystallEstimation{ 1 };
-    float eggsEstimation{ 1 };
+    T* data() { return values_.data(); }
+    const T* data() const { return values_.data(); }
+    T* begin() { return values_.data(); }
+    const T* begin() const { return values_.data(); }
+    T* end() { return values_.data() + size_; }
+    const T* end() const { return values_.data() + size_; }
 
-    // map srcCellIdx -> map < dstCellIdx -> shortestPath >
-    std::vector<std::map<int, std::vector<int>>> pathMapVec;
+    T& operator[](size_t idx) { return values_[idx]; }
+    const T& operator[](size_t idx) const { return values_[idx]; }
 
-    // map worth of cell to cell for every colony
-    // colony id -> estimation -> cell
-    std::map<int, std::map<float, std::set<int>>> worthToCellSetColonyMap;
+private:
+    std::array<T, Capacity> values_{};
+    size_t size_{ 0 };
+};
 
-    int friendlyAntsOnCurTurn;
-    std::set<int> friendlyCellsOnTurn;
+template <class T>
+class BoundedVector<T, kDynamicCapacity>: public std::vector<T>
+{
+};
 
-    //    : cell -> cell,     
-    std::map<int, std::map<int, int>> coloniesLinesMap;
+// neighbour indexes of all cells, one array per direction
+template <int Capacity>
+using NeighbourArrays = std::array<BoundedVector<int, Capacity>, 6>;
 
-    //     ,     
-    std::map<int, std::set<int>> coloniesBeaconsSetMap;
+// monotonic bump allocator for containers which live a single turn: memory is only taken and
+// reset() at the start of the turn returns all of it at once. Blocks are kept between turns,
+// so when the arena has grown to the size of the biggest turn it stops calling operator new
+class TurnArena
+{
+public:
+    static constexpr size_t kMinBlockSize = 1 << 16;
 
-    // colony id -> set of colonies cells
-    std::map<int, std::set<int>> turnColoniesMap;
+    TurnArena() = default;
+    TurnArena(const TurnArena&) = delete;
+    TurnArena& operator=(const TurnArena&) = delete;
 
-    void init()
+    ~TurnArena()
     {
-        cin >> numberOfCells;
-        cin.ignore();
-
-        cells.resize(numberOfCells);
-        for (int i = 0; i < numberOfCells; i++)
+        for (const Block& block : blocks_)
         {
-            cells[i].readInitState();
-
-            if (cells[i].type == Cell::Crystal)
-            {
-                crystalCells.insert(i);
-                totalCrystalsNb += cells[i].initialResources;
-
-            }
+            ::operator delete(block.data);
+        }
+    }
 
-            if (cells[i].type == Cell::Egg)
+    void* allocate(size_t size, size_t alignment)
+    {
+        while (blockIdx_ < blocks_.size())
+        {
+            const Block& block = blocks_[blockIdx_];
+            const size_t offset = (offset_ + alignment - 1) & ~(alignment - 1);
+            if (offset + size <= block.size)
             {
-                eggsCells.insert(i);
-                totalEggsNb += cells[i].initialResources;
+                offset_ = offset + size;
+                return block.data + offset;
             }
+            blockIdx_++;
+            offset_ = 0;
         }
-        cin.ignore();
-
-        eggsEstimation = float(totalCrystalsNb) / float(totalEggsNb);
-
-        cin >> numberOfBases;
-        cin.ignore();
 
-        friendlyBases.resize(numberOfBases);
-        opponentBases.resize(numberOfBases);
+        addBlock(std::max(size + alignment, blocks_.empty() ? kMinBlockSize : 2 * blocks_.back().size));
+        return allocate(size, alignment);
+    }
 
-        for (int i = 0; i < numberOfBases; i++)
+    // memory of several blocks is joined into one, so the next turn fits into a single block
+    void reset()
+    {
+        if (blocks_.size() > 1)
         {
-            cin >> friendlyBases[i];
-            cin.ignore();
+            size_t totalSize = 0;
+            for (const Block& block : blocks_)
+            {
+                totalSize += block.size;
+                ::operator delete(block.data);
+            }
+            blocks_.clear();
+            addBlock(totalSize);
         }
+        blockIdx_ = 0;
+        offset_ = 0;
+    }
 
-        for (int i = 0; i < numberOfBases; i++)
+    // memory taken since the last reset(), alignment gaps and unused block tails included
+    size_t usedBytes() const
+    {
+        size_t usedSize = offset_;
+        for (size_t blockIdx = 0; blockIdx < blockIdx_ && blockIdx < blocks_.size(); blockIdx++)
         {
-            cin >> opponentBases[i];
-            cin.ignore();
+            usedSize += blocks_[blockIdx].size;
         }
+        return usedSize;
     }
 
-    void calcDistances()
+    size_t capacity() const
     {
-        pathMapVec.resize(numberOfCells);
-        for (int cellIdx = 0; cellIdx < numberOfCells; cellIdx++)
+        size_t totalSize = 0;
+        for (const Block& block : blocks_)
         {
-            makePathMap(cellIdx);
+            totalSize += block.size;
         }
-
-        // std::cerr << "Max field distance: " << maxFieldDist << std::endl;
+        return totalSize;
     }
 
-    void continueBuildPath(std::list<int> nextNeightList, std::map<int, std::vector<int>>& resultPathsMap)
+private:
+    struct Block
     {
-        do
-        {
-            std::list<int> cellsToPromoute = nextNeightList;
-            nextNeightList.clear();
+        char* data;
+        size_t size;
+    };
 
-            for (int cellToPromoute : cellsToPromoute)
-            {
-                for (int neighCell : cells[cellToPromoute].neighArr)
-                {
-                    if (neighCell == -1 || resultPathsMap.count(neighCell))
-                    {
-                        // std::cerr << " already visited " << std::endl;
-                        continue;
-                    }
+    std::vector<Block> blocks_;
+    size_t blockIdx_{ 0 };
+    size_t offset_{ 0 };
 
-                    nextNeightList.push_back(neighCell);
+    void addBlock(size_t size)
+    {
+        blocks_.push_back({ static_cast<char*>(::operator new(size)), size });
+        blockIdx_ = blocks_.size() - 1;
+        offset_ = 0;
+    }
+};
 
-                    // std::cerr << " isn't visited, save path " << std::endl;
+// std allocator over TurnArena; without arena it is plain operator new, so the same container types
+// serve long-living data. Copies of containers always get operator new, arena is never taken implicitly
+template <class T>
+struct ArenaAllocator
+{
+    using value_type = T;
 
-                    resultPathsMap[neighCell] = resultPathsMap[cellToPromoute];
-                    resultPathsMap[neighCell].push_back(neighCell);
+    TurnArena* arena{ nullptr };
 
-                    if (resultPathsMap[neighCell].size() > maxFieldDist)
-                    {
-                        maxFieldDist = resultPathsMap[neighCell].size();
-                    }
-                }
-            }
-        } while (!nextNeightList.empty());
-    }
+    ArenaAllocator() = default;
+    ArenaAllocator(TurnArena* arena):
+        arena{ arena } {}
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U>& other):
+        arena{ other.arena } {}
 
-    void makePathMap(int startCell)
+    T* allocate(size_t n)
     {
-        std::map<int, std::vector<int>>& resultPathsMap = pathMapVec[startCell];
-        resultPathsMap[startCell] = {};
-        continueBuildPath({ startCell }, resultPathsMap);
+        return static_cast<T*>(arena ? arena->allocate(n * sizeof(T), alignof(T)) : ::operator new(n * sizeof(T)));
     }
 
-    void readTurnState()
+    void deallocate(T* ptr, size_t)
     {
-        friendlyCellsOnTurn.clear();
-        friendlyAntsOnCurTurn = 0;
-
-        for (int cellIdx = 0; cellIdx < cells.size(); cellIdx++)
+        if (!arena)
         {
-            cells.at(cellIdx).readTurnState();
-
-            if (cells.at(cellIdx).myAnts)
-            {
-                friendlyAntsOnCurTurn += cells.at(cellIdx).myAnts;
-                friendlyCellsOnTurn.insert(cellIdx);
-            }
+            ::operator delete(ptr);
         }
     }
 
-    void buildColonies()
-    {
-        turnColoniesMap.clear();
+    ArenaAllocator select_on_container_copy_construction() const { return {}; }
+
+    template <class U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+    template <class U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+};
+
+template <class T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+template <class Key, class Value>
+using ArenaMap = std::map<Key, Value, std::less<Key>, ArenaAllocator<std::pair<const Key, Value>>>;
+
+// dense bitset of cell indexes, sized to the map cells number; grows on insert of a cell out of size.
+// Keeps std::set-like interface (insert/erase/count/size), iteration goes in ascending order
+struct CellSet
+{
+    ArenaVector<uint64_t> words;
 
-        // map cell id -> colony id
-        std::map<int, int> cellInColonies;
+    CellSet() = default;
+    CellSet(int cellsNb, TurnArena* arena = nullptr):
+        words((size_t(cellsNb) + 63) / 64, 0, ArenaAllocator<uint64_t>(arena)) {}
 
-        // prepare: enumerate all cell by it own colony
-        for (int cell : friendlyCellsOnTurn)
+    struct Iterator
+    {
+        const uint64_t* words;
+        size_t wordIdx;
+        size_t wordsNb;
+        uint64_t curWord;
+
+        Iterator(const uint64_t* words, size_t wordIdx, size_t wordsNb):
+            words{ words }, wordIdx{ wordIdx }, wordsNb{ wordsNb }, curWord{ wordIdx < wordsNb ? words[wordIdx] : 0 }
         {
-            cells[cell].colonyId = cellInColonies.size() + 1;
-            cellInColonies[cell] = cells[cell].colonyId;
+            skipEmptyWords();
         }
 
-        //             -      
-        //       existNewUnions
-        bool existNewUnions = true;
-        while (existNewUnions)
+        int operator*() const { return int(wordIdx * 64 + __builtin_ctzll(curWord)); }
+        bool operator!=(const Iterator& other) const { return wordIdx != other.wordIdx || curWord != other.curWord; }
+        Iterator& operator++()
         {
-            existNewUnions = false;
+            curWord &= curWord - 1;
+            skipEmptyWords();
+            return *this;
+        }
 
-            for (int cell : friendlyCellsOnTurn)
+    private:
+        // current word is cached, so erasing the current cell during iteration is safe
+        void skipEmptyWords()
+        {
+            while (!curWord && wordIdx < wordsNb)
             {
-                int minColonyIdInNeigh = cells[cell].colonyId;
-                for (int neighCellIdx : cells[cell].neighArr)
-                {
-                    if (friendlyCellsOnTurn.count(neighCellIdx) && cells[neighCellIdx].colonyId < minColonyIdInNeigh)
-                    {
-                        minColonyIdInNeigh = cells[neighCellIdx].colonyId;
-                    }
-                }
-
-                if (minColonyIdInNeigh != cells[cell].colonyId)
-                {
-                    existNewUnions = true;
-                    cells[cell].colonyId = minColonyIdInNeigh;
-                }
-
-                for (int neighCellIdx : cells[cell].neighArr)
-                {
-                    if (friendlyCellsOnTurn.count(neighCellIdx))
-                    {
-                        cells[neighCellIdx].colonyId = minColonyIdInNeigh;
-                    }
-                }
+                wordIdx++;
+                curWord = wordIdx < wordsNb ? words[wordIdx] : 0;
             }
         }
+    };
+
+    Iterator begin() const { return { words.data(), 0, words.size() }; }
+    Iterator end() const { return { words.data(), words.size(), words.size() }; }
+
+    void resize(int cellsNb)
+    {
+        words.assign((size_t(cellsNb) + 63) / 64, 0);
+    }
 
-        //       
+    void clear()
+    {
+        std::fill(words.begin(), words.end(), 0);
+    }
 
-        //     
-        for (int cell : friendlyCellsOnTurn)
+    void insert(int cell)
+    {
+        const size_t wordIdx = size_t(cell) / 64;
+        if (wordIdx >= words.size())
         {
-            turnColoniesMap[cells[cell].colonyId].insert(cell);
+            words.resize(wordIdx + 1, 0);
         }
+        words[wordIdx] |= uint64_t(1) << (cell % 64);
+    }
 
-        for (const auto& colonyPair : turnColoniesMap)
+    void erase(int cell)
+    {
+        const size_t wordIdx = size_t(cell) / 64;
+        if (wordIdx < words.size())
         {
-            std::cerr << "Colony " << colonyPair.first << ": [";
-            for (int cell : colonyPair.second)
-            {
-                std::cerr << cell;
-                if (cell != *std::prev(colonyPair.second.end()))
-                {
-                    std::cerr << ", ";
-                }
-            }
-            std::cerr << "]\n";
+            words[wordIdx] &= ~(uint64_t(1) << (cell % 64));
         }
+    }
+
+    bool count(int cell) const
+    {
+        const size_t wordIdx = size_t(cell) / 64;
+        return wordIdx < words.size() && (words[wordIdx] >> (cell % 64) & 1);
+    }
 
-        //  "" 
-        //   ,        
-        int lastCheckedColonyId = -1;
-        auto colonyToCheckIter = turnColoniesMap.upper_bound(lastCheckedColonyId);
-        while (colonyToCheckIter != turnColoniesMap.end())
+    int size() const
+    {
+        int cellsNb = 0;
+        for (uint64_t word : words)
         {
-            lastCheckedColonyId = colonyToCheckIter->first;
-            // std::cerr << "Check Colony " << lastCheckedColonyId << " degeneracy..." << std::endl;
+            cellsNb += __builtin_popcountll(word);
+        }
+        return cellsNb;
+    }
 
-            bool isColonyWithFriendlyBase = false;
-            for (int friendlyBase : friendlyBases)
+    bool empty() const
+    {
+        for (uint64_t word : words)
+        {
+            if (word)
             {
-                if (colonyToCheckIter->second.count(friendlyBase))
-                {
-                    isColonyWithFriendlyBase = true;
-                    break;
-                }
+                return false;
             }
+        }
+        return true;
+    }
 
-            if (!isColonyWithFriendlyBase)
+    bool intersects(const CellSet& other) const
+    {
+        const size_t wordsNb = std::min(words.size(), other.words.size());
+        for (size_t wordIdx = 0; wordIdx < wordsNb; wordIdx++)
+        {
+            if (words[wordIdx] & other.words[wordIdx])
             {
-                // std::cerr << "Colony " << lastCheckedColonyId << " hasn't friendly base and is degenrated, forget it" << std::endl;
-                turnColoniesMap.erase(lastCheckedColonyId);
+                return true;
             }
-            colonyToCheckIter = turnColoniesMap.upper_bound(lastCheckedColonyId);
         }
+        return false;
     }
 
-    void makeTurnEstimation()
+    CellSet& operator|=(const CellSet& other)
     {
-        worthToCellSetColonyMap.clear();
-        onTurnMapCrystalsNb = 0;
-        onTurnMapEggsNb = 0;
-
-//       ,     
-        std::set<int> newEggCellSet; // set with updated egg cells
-        for (int eggCell : eggsCells)
+        if (words.size() < other.words.size())
         {
-            // skip cell without eggs
-            if (cells.at(eggCell).curResources == 0)
-            {
-                continue;
-            }
-            newEggCellSet.insert(eggCell); // save cell with egg
-            onTurnMapEggsNb += cells.at(eggCell).curResources;
+            words.resize(other.words.size(), 0);
         }
-        // save update egg vec if it updated
-        if (newEggCellSet.size() != eggsCells.size())
+        for (size_t wordIdx = 0; wordIdx < other.words.size(); wordIdx++)
         {
-            eggsCells = newEggCellSet;
+            words[wordIdx] |= other.words[wordIdx];
         }
+        return *this;
+    }
 
-//       ,     
-        std::set<int> newCrystalCellSet; // set with updated crystal cells
-        for (int crystalCell : crystalCells)
+    CellSet& operator&=(const CellSet& other)
+    {
+        for (size_t wordIdx = 0; wordIdx < words.size(); wordIdx++)
         {
-            // skip cell without crystals
-            if (cells.at(crystalCell).curResources == 0)
-            {
-                continue;
-            }
-            newCrystalCellSet.insert(crystalCell); // save cell with crystal
-            onTurnMapCrystalsNb += cells.at(crystalCell).curResources;
+            words[wordIdx] &= wordIdx < other.words.size() ? other.words[wordIdx] : 0;
         }
-        // save update crystal vec if it updated
-        if (newCrystalCellSet.size() != crystalCells.size())
+        return *this;
+    }
+
+    // difference
+    CellSet& operator-=(const CellSet& other)
+    {
+        const size_t wordsNb = std::min(words.size(), other.words.size());
+        for (size_t wordIdx = 0; wordIdx < wordsNb; wordIdx++)
         {
-            crystalCells = newCrystalCellSet;
+            words[wordIdx] &= ~other.words[wordIdx];
         }
+        return *this;
+    }
+};
 
-//   
-//       -   
-        crystallEstimation = float(totalCrystalsNb) / float(onTurnMapCrystalsNb);
+// fifo of cell indexes over preallocated ring buffer, never allocates after reset()
+struct CellQueue
+{
+    ArenaVector<int> buffer;
+    size_t mask{ 0 };
+    size_t head{ 0 };
+    size_t tail{ 0 };
 
-//   -       
-//      
-        if (friendlyAntsOnCurTurn > totalCrystalsNb / 2)
+    CellQueue(TurnArena* arena = nullptr):
+        buffer{ ArenaAllocator<int>(arena) } {}
+
+    void reset(int minCapacity)
+    {
+        size_t capacity = 1;
+        while (capacity < size_t(minCapacity))
         {
-            crystallEstimation *= 10;
+            capacity <<= 1;
         }
+        buffer.resize(capacity);
+        mask = capacity - 1;
+        clear();
+    }
 
-//      
-        for (const auto& colonyWorthMapPair : turnColoniesMap)
-        {
-            const int colonyId = colonyWorthMapPair.first;
+    void clear() { head = tail = 0; }
+    bool empty() const { return head == tail; }
+    size_t size() const { return tail - head; }
+    void push(int cell) { buffer[tail++ & mask] = cell; }
+    int pop() { return buffer[head++ & mask]; }
+};
 
-            //   : cell -> worth
-            std::map<int, float> curColonyWorthMap;
+// multi-source BFS: distance from every cell to the nearest source cell and that source itself;
+// sources may be added after propagate(), then only the improved region is relaxed again.
+// On equal distances the smaller source wins, as it did in linear scans over ordered cell sets
+struct DistanceField
+{
+    static constexpr uint16_t kUnreachableDist = 0xFFFF;
 
-    // estimate egg cells
-            // std::cerr << "\tEstimate egg cells" << std::endl;
-            for (int eggCell : eggsCells)
-            {
-                const std::map<int, std::vector<int>>& pathMapFromEggCell = pathMapVec.at(eggCell);
+    ArenaVector<uint16_t> dists;
+    ArenaVector<int> nearestSources;
+    std::vector<bool, ArenaAllocator<bool>> queuedCells;
+    CellQueue queue;
 
-            // find nearest friendly cell IN THIS COLONY to this egg cell
-                int distFromNearestColonyCell = maxFieldDist;
+    DistanceField(TurnArena* arena = nullptr):
+        dists{ ArenaAllocator<uint16_t>(arena) }, nearestSources{ ArenaAllocator<int>(arena) },
+        queuedCells{ ArenaAllocator<bool>(arena) }, queue{ arena } {}
 
-                const std::set<int>& friendlyCellsInColonySet = colonyWorthMapPair.second;
-                for (int friendlyColonyCell : friendlyCellsInColonySet)
-                {
-                    const std::vector<int>& shortestPathListFromEggToThisCell = pathMapFromEggCell.at(friendlyColonyCell);
-                    if (shortestPathListFromEggToThisCell.size() < distFromNearestColonyCell)
-                    {
-                        distFromNearestColonyCell = int(shortestPathListFromEggToThisCell.size());
-                    }
-                }
+    // extra sentinel cell cellsNb has zero distance and no source, so it is never relaxed
+    void reset(int cellsNb)
+    {
+        dists.assign(cellsNb + 1, kUnreachableDist);
+        nearestSources.assign(cellsNb + 1, -1);
+        queuedCells.assign(cellsNb + 1, false);
+        dists[cellsNb] = 0;
+        if (queue.buffer.size() < size_t(cellsNb))
+        {
+            queue.reset(cellsNb);
+        }
+        queue.clear();
+    }
 
-                float distCoef = distFromNearestColonyCell == 0 ? 2 : (1 / float(distFromNearestColonyCell));
-                curColonyWorthMap[eggCell] = float(cells.at(eggCell).curResources * eggsEstimation) * distCoef;
+    void addSource(int cell)
+    {
+        if (dists[cell] == 0 && nearestSources[cell] <= cell)
+        {
+            return;
+        }
+        dists[cell] = 0;
+        nearestSources[cell] = cell;
+        enqueue(cell);
+    }
+
+    // label-correcting BFS from all sources added since the last call
+    template <int Capacity>
+    void propagate(const NeighbourArrays<Capacity>& neighs)
+    {
+        while (!queue.empty())
+        {
+            const int cell = queue.pop();
+            queuedCells[cell] = false;
+
+            const uint16_t nextDist = dists[cell] + 1;
+            const int source = nearestSources[cell];
+            for (const BoundedVector<int, Capacity>& dirNeighs : neighs)
+            {
+                const int neighCell = dirNeighs[cell];
+                if (nextDist < dists[neighCell] || (nextDist == dists[neighCell] && source < nearestSources[neighCell]))
+                {
+                    dists[neighCell] = nextDist;
+                    nearestSources[neighCell] = source;
+                    enqueue(neighCell);
+                }
+            }
+        }
+    }
+
+private:
+    void enqueue(int cell)
+    {
+        if (!queuedCells[cell])
+        {
+            queuedCells[cell] = true;
+            queue.push(cell);
+        }
+    }
+};
+
+struct ScoredCell
+{
+    float score;
+    int cell;
+};
+
+// unique integer key which orders candidates exactly as their scores and then cells do: order-preserving
+// bits of the score in the high half (both zeros are the same score), inverted cell in the low half
+inline uint64_t candidateKey(const ScoredCell& candidate)
+{
+    const float score = candidate.score + 0.f;
+    uint32_t scoreBits;
+    std::memcpy(&scoreBits, &score, sizeof(scoreBits));
+    scoreBits = scoreBits & 0x80000000u ? ~scoreBits : scoreBits | 0x80000000u;
+    return uint64_t(scoreBits) << 32 | ~uint32_t(candidate.cell);
+}
+
+// higher score first, smaller cell first on equal scores
+inline bool isWorseCandidate(const ScoredCell& lhs, const ScoredCell& rhs)
+{
+    return candidateKey(lhs) < candidateKey(rhs);
+}
+
+inline ScoredCell candidateOfKey(uint64_t key)
+{
+    uint32_t scoreBits = uint32_t(key >> 32);
+    scoreBits = scoreBits & 0x80000000u ? scoreBits & 0x7FFFFFFFu : ~scoreBits;
+    ScoredCell candidate;
+    std::memcpy(&candidate.score, &scoreBits, sizeof(scoreBits));
+    candidate.cell = int(~uint32_t(key));
+    return candidate;
+}
+
+// candidates from the best by LSD radix sort over bytes of their inverted keys, keys and buffer are the scratch;
+// only the bytes which differ between the keys are sorted, short lists are cheaper to sort by comparisons of keys
+template <class Vector, class KeyVector>
+void radixSortCandidates(Vector& items, KeyVector& keys, KeyVector& buffer)
+{
+    constexpr size_t kMinRadixSortSize = 256;
+
+    keys.resize(items.size());
+    buffer.resize(items.size());
+    uint64_t differentBits = 0;
+    for (size_t itemIdx = 0; itemIdx < items.size(); itemIdx++)
+    {
+        keys[itemIdx] = ~candidateKey(items[itemIdx]);
+        differentBits |= keys[itemIdx] ^ keys[0];
+    }
+
+    if (keys.size() < kMinRadixSortSize)
+    {
+        std::sort(keys.begin(), keys.end());
+        differentBits = 0;
+    }
+    // after the sort by comparisons no byte is left for the radix passes
+    for (int shift = 0; shift < 64; shift += 8)
+    {
+        if (!(differentBits >> shift & 0xFF))
+        {
+            continue;
+        }
+        std::array<uint32_t, 257> offsets{};
+        for (uint64_t key : keys)
+        {
+            offsets[(key >> shift & 0xFF) + 1]++;
+        }
+        for (size_t digit = 1; digit < offsets.size(); digit++)
+        {
+            offsets[digit] += offsets[digit - 1];
+        }
+        for (uint64_t key : keys)
+        {
+            buffer[offsets[key >> shift & 0xFF]++] = key;
+        }
+        keys.swap(buffer);
+    }
+
+    for (size_t itemIdx = 0; itemIdx < items.size(); itemIdx++)
+    {
+        items[itemIdx] = candidateOfKey(~keys[itemIdx]);
+    }
+}
+
+// worth of colony target cells: contiguous array of all candidates plus binary max-heap over it,
+// taken (already beaconed) cells are dropped from the heap lazily when they come to its top;
+// candidates sorted from the best are built on demand for the scans which stop by the score bound
+struct CandidateList
+{
+    ArenaVector<ScoredCell> items;
+    ArenaVector<ScoredCell> heap;
+    ArenaVector<ScoredCell> ranked;
+    ArenaVector<uint64_t> sortKeys;
+    ArenaVector<uint64_t> sortBuffer;
+
+    CandidateList(TurnArena* arena = nullptr):
+        items{ ArenaAllocator<ScoredCell>(arena) }, heap{ ArenaAllocator<ScoredCell>(arena) },
+        ranked{ ArenaAllocator<ScoredCell>(arena) }, sortKeys{ ArenaAllocator<uint64_t>(arena) },
+        sortBuffer{ ArenaAllocator<uint64_t>(arena) } {}
+
+    void clear()
+    {
+        items.clear();
+        heap.clear();
+        ranked.clear();
+    }
+
+    void reserve(int candidatesNb)
+    {
+        items.reserve(candidatesNb);
+        heap.reserve(candidatesNb);
+    }
+
+    const ArenaVector<ScoredCell>& rankedItems()
+    {
+        if (ranked.size() != items.size())
+        {
+            ranked.assign(items.begin(), items.end());
+            radixSortCandidates(ranked, sortKeys, sortBuffer);
+        }
+        return ranked;
+    }
+
+    bool empty() const { return items.empty(); }
+
+    void add(float score, int cell)
+    {
+        items.push_back({ score, cell });
+    }
+
+    void buildHeap()
+    {
+        heap.assign(items.begin(), items.end());
+        std::make_heap(heap.begin(), heap.end(), isWorseCandidate);
+    }
+
+    // best candidate for which isTaken(cell) is false, nullptr if there is no one
+    template <class TakenPredicate>
+    const ScoredCell* bestFree(TakenPredicate isTaken)
+    {
+        while (!heap.empty() && isTaken(heap.front().cell))
+        {
+            std::pop_heap(heap.begin(), heap.end(), isWorseCandidate);
+            heap.pop_back();
+        }
+        return heap.empty() ? nullptr : &heap.front();
+    }
+};
+
+// formats commands straight into fixed buffer, the whole turn goes out with a single write
+struct CommandEmitter
+{
+    static constexpr size_t kBufferSize = 1 << 16;
+    // longest command without message text: "LINE " + 3 * (int + separator)
+    static constexpr size_t kMaxCommandLength = 48;
+
+    int fd{ 1 };
+    char buffer[kBufferSize];
+    size_t len{ 0 };
+    int commandsNb{ 0 };
+
+    CommandEmitter(int fd = 1):
+        fd{ fd } {}
+
+    void beacon(int index, int strength)
+    {
+        reserve(kMaxCommandLength);
+        appendText("BEACON ");
+        appendInt(index);
+        appendChar(' ');
+        appendInt(strength);
+        appendChar(';');
+        commandsNb++;
+    }
+
+    void line(int index1, int index2, int strength)
+    {
+        reserve(kMaxCommandLength);
+        appendText("LINE ");
+        appendInt(index1);
+        appendChar(' ');
+        appendInt(index2);
+        appendChar(' ');
+        appendInt(strength);
+        appendChar(';');
+        commandsNb++;
+    }
+
+    void message(const char* text)
+    {
+        const size_t textLen = std::strlen(text);
+        reserve(kMaxCommandLength + textLen);
+        appendText("MESSAGE ");
+        std::memcpy(buffer + len, text, std::min(textLen, kBufferSize - kMaxCommandLength));
+        len += std::min(textLen, kBufferSize - kMaxCommandLength);
+        appendChar(';');
+        commandsNb++;
+    }
+
+    void wait()
+    {
+        reserve(kMaxCommandLength);
+        appendText("WAIT;");
+        commandsNb++;
+    }
+
+    // end turn line, empty turn is WAIT
+    void flush()
+    {
+        if (!commandsNb)
+        {
+            wait();
+        }
+        appendChar('\n');
+        writeBuffer();
+        commandsNb = 0;
+    }
+
+private:
+    void reserve(size_t length)
+    {
+        if (len + length > kBufferSize)
+        {
+            writeBuffer();
+        }
+    }
+
+    void appendChar(char c)
+    {
+        buffer[len++] = c;
+    }
+
+    template <size_t N>
+    void appendText(const char (&text)[N])
+    {
+        std::memcpy(buffer + len, text, N - 1);
+        len += N - 1;
+    }
+
+    void appendInt(int value)
+    {
+        if (value < 0)
+        {
+            appendChar('-');
+            value = -value;
+        }
+
+        char digits[12];
+        int digitsNb = 0;
+        do
+        {
+            digits[digitsNb++] = char('0' + value % 10);
+            value /= 10;
+        } while (value);
+
+        while (digitsNb)
+        {
+            appendChar(digits[--digitsNb]);
+        }
+    }
+
+    void writeBuffer()
+    {
+        // negative descriptor discards output
+        if (fd < 0)
+        {
+            len = 0;
+            return;
+        }
+
+        size_t written = 0;
+#if defined(__unix__) || defined(__APPLE__)
+        while (written < len)
+        {
+            const ssize_t writtenNb = ::write(fd, buffer + written, len - written);
+            if (writtenNb < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (writtenNb <= 0)
+            {
+                break;
+            }
+            written += size_t(writtenNb);
+        }
+#else
+        std::fwrite(buffer, 1, len, stdout);
+        std::fflush(stdout);
+#endif
+        len = 0;
+    }
+};
+
+// debug adapters over CommandEmitter, stringify() gives text of single command
+struct Action
+{
+    Action() = default;
+    virtual ~Action() = default;
+    virtual void emit(CommandEmitter& emitter)
+    {
+        emitter.wait();
+    }
+    virtual std::string stringify()
+    {
+        return "WAIT;";
+    };
+};
+struct BeaconAction: public Action
+{
+    int index, strength;
+    BeaconAction(int index, int strength):
+        index{ index }, strength{ strength } {}
+    void emit(CommandEmitter& emitter) final
+    {
+        emitter.beacon(index, strength);
+    }
+    std::string stringify() final
+    {
+        return "BEACON "
+                + std::to_string(index) + " "
+                + std::to_string(strength) + ";";
+    }
+};
+struct LineAction: public Action
+{
+    int index1, index2, strength;
+    LineAction(int index1, int index2, int strength) :
+        index1{ index1 }, index2{ index2 }, strength{ strength } {}
+    void emit(CommandEmitter& emitter) final
+    {
+        emitter.line(index1, index2, strength);
+    }
+    std::string stringify() final
+    {
+        return "LINE "
+                + std::to_string(index1) + " "
+                + std::to_string(index2) + " "
+                + std::to_string(strength) + ";";
+    }
+};
+struct MessageAction: public Action
+{
+    std::string message;
+    MessageAction(const std::string& message):
+        message{message} {}
+    void emit(CommandEmitter& emitter) final
+    {
+        emitter.message(message.c_str());
+    }
+    std::string stringify() final
+    {
+        return "MESSAGE " + message + ";";
+    }
+};
+
+// worths[cell] + neighCoef * (sum of worths of cell neighbours), summed in the same order as the vector kernel
+template <int Capacity>
+inline float diffuseCellWorth(const float* worths, const NeighbourArrays<Capacity>& neighs, int cell, float neighCoef)
+{
+    float neighWorthsSum = 0.f;
+    for (const BoundedVector<int, Capacity>& dirNeighs : neighs)
+    {
+        neighWorthsSum += worths[dirNeighs[cell]];
+    }
+    return worths[cell] + neighWorthsSum * neighCoef;
+}
+
+// diffused[i] = worths[i] + neighCoef * (sum of worths of i neighbours) for all cells, cellsNb is multiple of 8
+template <int Capacity>
+inline void diffuseCellWorthsScalar(const float* worths, const NeighbourArrays<Capacity>& neighs, float* diffused, int cellsNb, float neighCoef)
+{
+    for (int cell = 0; cell < cellsNb; cell++)
+    {
+        diffused[cell] = diffuseCellWorth(worths, neighs, cell, neighCoef);
+    }
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SPRING_CHALLENGE_AVX2_KERNEL
+template <int Capacity>
+__attribute__((target("avx2")))
+inline void diffuseCellWorthsAvx2(const float* worths, const NeighbourArrays<Capacity>& neighs, float* diffused, int cellsNb, float neighCoef)
+{
+    const __m256 neighCoefVec = _mm256_set1_ps(neighCoef);
+    for (int cell = 0; cell < cellsNb; cell += 8)
+    {
+        __m256 neighWorthsSum = _mm256_setzero_ps();
+        for (const BoundedVector<int, Capacity>& dirNeighs : neighs)
+        {
+            const __m256i neighIdxs = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dirNeighs.data() + cell));
+            neighWorthsSum = _mm256_add_ps(neighWorthsSum, _mm256_i32gather_ps(worths, neighIdxs, 4));
+        }
+        const __m256 cellWorths = _mm256_loadu_ps(worths + cell);
+        _mm256_storeu_ps(diffused + cell, _mm256_add_ps(cellWorths, _mm256_mul_ps(neighWorthsSum, neighCoefVec)));
+    }
+}
+#endif
+
+template <int Capacity>
+inline void diffuseCellWorths(const float* worths, const NeighbourArrays<Capacity>& neighs, float* diffused, int cellsNb, float neighCoef)
+{
+#ifdef SPRING_CHALLENGE_AVX2_KERNEL
+    static const bool isAvx2Supported = __builtin_cpu_supports("avx2");
+    if (isAvx2Supported)
+    {
+        diffuseCellWorthsAvx2(worths, neighs, diffused, cellsNb, neighCoef);
+        return;
+    }
+#endif
+    diffuseCellWorthsScalar(worths, neighs, diffused, cellsNb, neighCoef);
+}
+
+// state which Field carries from turn to turn: the turn input and resource cells which are still
+// on the map; any turn can be computed from its snapshot and the static map alone
+struct FieldSnapshot
+{
+    std::vector<int> curResources;
+    std::vector<int> myAnts;
+    std::vector<int> oppAnts;
+    CellSet eggsCells;
+    CellSet crystalCells;
+
+    // cells number, turn input arrays (int32) and words of both cell sets (uint64), host byte order
+    void serialize(std::vector<uint8_t>& bytes) const
+    {
+        const uint32_t cellsNb = uint32_t(curResources.size());
+        appendBytes(bytes, &cellsNb, sizeof(cellsNb));
+        for (const std::vector<int>* values : { &curResources, &myAnts, &oppAnts })
+        {
+            appendBytes(bytes, values->data(), values->size() * sizeof(int32_t));
+        }
+        for (const CellSet* cells : { &eggsCells, &crystalCells })
+        {
+            appendBytes(bytes, cells->words.data(), cells->words.size() * sizeof(uint64_t));
+        }
+    }
+
+    // reads the snapshot at pos and moves pos after it, false on truncated data
+    bool deserialize(const uint8_t* data, size_t size, size_t& pos)
+    {
+        uint32_t cellsNb;
+        if (!readBytes(data, size, pos, &cellsNb, sizeof(cellsNb)))
+        {
+            return false;
+        }
+        for (std::vector<int>* values : { &curResources, &myAnts, &oppAnts })
+        {
+            values->resize(cellsNb);
+            if (!readBytes(data, size, pos, values->data(), values->size() * sizeof(int32_t)))
+            {
+                return false;
+            }
+        }
+        for (CellSet* cells : { &eggsCells, &crystalCells })
+        {
+            cells->resize(int(cellsNb));
+            if (!readBytes(data, size, pos, cells->words.data(), cells->words.size() * sizeof(uint64_t)))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    static void appendBytes(std::vector<uint8_t>& bytes, const void* values, size_t valuesSize)
+    {
+        const uint8_t* valuesBytes = static_cast<const uint8_t*>(values);
+        bytes.insert(bytes.end(), valuesBytes, valuesBytes + valuesSize);
+    }
+
+    static bool readBytes(const uint8_t* data, size_t size, size_t& pos, void* values, size_t valuesSize)
+    {
+        if (size - pos < valuesSize)
+        {
+            return false;
+        }
+        std::memcpy(values, data + pos, valuesSize);
+        pos += valuesSize;
+        return true;
+    }
+};
+
+// entry of the per-turn map, constructed in place from args when it is missing
+template <class Value, class... Args>
+Value& turnMapEntry(ArenaMap<int, Value>& map, int key, Args&&... args)
+{
+    auto entryIter = map.lower_bound(key);
+    if (entryIter == map.end() || entryIter->first != key)
+    {
+        entryIter = map.emplace_hint(entryIter, std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+    }
+    return entryIter->second;
+}
+
+// map with at most MaxCells cells and MaxBases bases of every player keeps the cells arrays in place,
+// kDynamicCapacity for both allocates them for any map
+template <int MaxCells, int MaxBases>
+struct BasicField
+{
+    // capacity of the cells arrays, padding included
+    static constexpr int kCellsCapacity = MaxCells == kDynamicCapacity ? kDynamicCapacity : (MaxCells + 8) / 8 * 8;
+
+    template <class T>
+    using CellsArray = BoundedVector<T, kCellsCapacity>;
+    using BasesArray = BoundedVector<int, MaxBases>;
+
+    int numberOfCells;
+    // cells are stored as struct of arrays, padded to paddedCellsNb (multiple of 8, > numberOfCells);
+    // missing neighbours refer to the sentinel cell numberOfCells, all padding cells have zero data
+    int paddedCellsNb;
+    CellsArray<Cell::Type> cellTypes;
+    CellsArray<int> initialResources; //  the amount of crystal/egg here
+    NeighbourArrays<kCellsCapacity> neighs;
+
+    // per-turn cells data
+    CellsArray<int> curResources;
+    CellsArray<int> myAnts;
+    CellsArray<int> oppAnts;
+    int numberOfBases;
+    BasesArray friendlyBases;
+    BasesArray opponentBases;
+
+    int maxFieldDist{ 0 };
+
+    // per-turn debug output to stderr
+    bool isDebugLogEnabled{ true };
+
+    // synthetic
+    CellSet crystalCells;
+    CellSet eggsCells;
+
+    int totalCrystalsNb{ 0 };
+    int totalEggsNb{ 0 };
+
+    int onTurnMapCrystalsNb{ 0 };
+    int onTurnMapEggsNb{ 0 };
+
+    float crystallEstimation{ 1 };
+    float eggsEstimation{ 1 };
+
+    // flat all-pairs tables, row = source cell, column = destination cell:
+    // distances - length of the shortest path, nextDirs - index in neighs of the
+    // source cell's neighbour, lying on one of the shortest paths to the destination
+    std::vector<uint16_t> distances;
+    std::vector<uint8_t> nextDirs;
+
+    // mirrorCells[i] - cell point-symmetric to cell i, empty when the map has no such symmetry
+    CellsArray<int> mirrorCells;
+
+    CellQueue bfsQueue;
+
+    // turn input of the previous turn and cells where the current turn differs from it;
+    // turn data below is updated only at dirty cells, invalidateTurnState() makes all cells dirty
+    CellsArray<int> prevResources;
+    CellsArray<int> prevMyAnts;
+    CellsArray<int> prevOppAnts;
+    CellsArray<int> dirtyCells;
+    bool isTurnStateInvalid{ true };
+
+    // colonies are updated only when some cell became friendly or stopped being it
+    bool areColoniesDirty{ true };
+
+    // crystals estimation of colony worths
+    float worthsCrystallEstimation{ 0 };
+
+    static constexpr float kNeighWorthsCoef = 0.8f;
+
+    // memory of all per-turn containers below, it is reset by resetTurnContainers()
+    TurnArena turnArena;
+
+    // memory of colonies and all their data which is kept between turns; erased colonies leave their memory
+    // here, so it is reset and colonies are collected anew when it has doubled since the last reset
+    TurnArena colonyArena;
+    size_t colonyArenaLimit{ 0 };
+
+    // map worth of cell to cell for every colony
+    // colony id -> estimation -> cell
+    ArenaMap<int, CandidateList> worthCandidatesColonyMap{ &turnArena };
+
+    int friendlyAntsOnCurTurn;
+    CellSet friendlyCellsOnTurn;
+
+    // union-find over friendly cells which is kept between turns: new cells join the colonies of their
+    // neighbours, removed cells split their colonies by local BFS. Root cell keeps the size and the colony id,
+    // ids are stable: merged colonies keep the older id, the part with a friendly base keeps the id on split
+    CellsArray<int> colonyParents;
+    CellsArray<int> colonySizes;
+    CellsArray<int> colonyIds;
+    // friendly cells which are in the union-find
+    CellSet colonizedCells;
+    int nextColonyId{ 1 };
+
+    enum ColonyChange
+    {
+        // cells were only added, distances to the colony are relaxed from them
+        ColonyGrown,
+        // new colony or some cells were removed, colony data is computed from scratch
+        ColonyRebuilt,
+    };
+
+    struct ColonyUpdate
+    {
+        // some colony cell, -1 when the colony is gone
+        int memberCell;
+        ColonyChange change;
+    };
+
+    // colony id -> change on the current turn, colonies which aren't there are the same as on the previous turn
+    ArenaMap<int, ColonyUpdate> colonyUpdatesMap{ &turnArena };
+
+    //    : cell -> cell,     
+    ArenaMap<int, ArenaMap<int, int>> coloniesLinesMap{ &colonyArena };
+
+    // cells of the colony lines, they are kept while the colony and its resource cells are the same
+    ArenaMap<int, CellSet> coloniesLinesCellsMap{ &colonyArena };
+
+    //     ,     
+    ArenaMap<int, CellSet> coloniesBeaconsSetMap{ &colonyArena };
+
+    // colony id -> set of colonies cells
+    ArenaMap<int, CellSet> turnColoniesMap{ &colonyArena };
+
+    // colony id -> distances from all cells to the nearest colony cell
+    ArenaMap<int, DistanceField> colonyDistFieldMap{ &colonyArena };
+
+    // colony id -> worths of colony target cells before and after adding neighbours worths
+    ArenaMap<int, ArenaVector<float>> colonyCellWorthsMap{ &colonyArena };
+    ArenaMap<int, ArenaVector<float>> colonyDiffusedWorthsMap{ &colonyArena };
+
+    // every base is a separate cell of its player, so a valid map has at most cellsNb / 2 bases of every player
+    static bool fitsMap(int cellsNb, int basesNb)
+    {
+        return cellsNb > 0 && basesNb >= 0 && 2 * basesNb <= cellsNb
+            && (MaxCells == kDynamicCapacity || cellsNb <= MaxCells)
+            && (MaxBases == kDynamicCapacity || basesNb <= MaxBases);
+    }
+
+    // neighbours and bases which were read refer to the cells of the map
+    bool areMapCellsValid() const
+    {
+        for (const BoundedVector<int, kCellsCapacity>& dirNeighs : neighs)
+        {
+            for (int cell = 0; cell < numberOfCells; cell++)
+            {
+                if (dirNeighs[cell] < 0 || dirNeighs[cell] > numberOfCells)
+                {
+                    return false;
+                }
+            }
+        }
+        for (const BasesArray* bases : { &friendlyBases, &opponentBases })
+        {
+            for (int base : *bases)
+            {
+                if (base < 0 || base >= numberOfCells)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool init(InputReader& input)
+    {
+        return init(input.readInt(), input);
+    }
+
+    // rest of the map after the cells number, which the caller has read to choose the capacities;
+    // false when the map doesn't fit the capacities or refers to missing cells
+    bool init(int cellsNb, InputReader& input)
+    {
+        if (!fitsMap(cellsNb, 0))
+        {
+            return false;
+        }
+        initCells(cellsNb);
+
+        for (int i = 0; i < numberOfCells; i++)
+        {
+            cellTypes[i] = static_cast<Cell::Type>(input.readInt());
+            initialResources[i] = input.readInt();
+            for (BoundedVector<int, kCellsCapacity>& dirNeighs : neighs)
+            {
+                const int neighCell = input.readInt();
+                dirNeighs[i] = neighCell == -1 ? numberOfCells : neighCell;
+            }
+        }
+
+        numberOfBases = input.readInt();
+        if (!fitsMap(numberOfCells, numberOfBases))
+        {
+            return false;
+        }
+
+        friendlyBases.resize(numberOfBases);
+        opponentBases.resize(numberOfBases);
+
+        for (int i = 0; i < numberOfBases; i++)
+        {
+            friendlyBases[i] = input.readInt();
+        }
+
+        for (int i = 0; i < numberOfBases; i++)
+        {
+            opponentBases[i] = input.readInt();
+        }
+        if (!areMapCellsValid())
+        {
+            return false;
+        }
+
+        finishInit();
+        return true;
+    }
+
+    // static data of other field, bases are swapped for the second player; distances are copied if calculated
+    void init(const BasicField& mapField, bool isSecondPlayer)
+    {
+        initCells(mapField.numberOfCells);
+
+        cellTypes = mapField.cellTypes;
+        initialResources = mapField.initialResources;
+        neighs = mapField.neighs;
+
+        numberOfBases = mapField.numberOfBases;
+        friendlyBases = isSecondPlayer ? mapField.opponentBases : mapField.friendlyBases;
+        opponentBases = isSecondPlayer ? mapField.friendlyBases : mapField.opponentBases;
+
+        finishInit();
+
+        distances = mapField.distances;
+        nextDirs = mapField.nextDirs;
+        mirrorCells = mapField.mirrorCells;
+        maxFieldDist = mapField.maxFieldDist;
+    }
+
+    // allocate all cells arrays
+    void initCells(int cellsNb)
+    {
+        numberOfCells = cellsNb;
+
+        paddedCellsNb = (numberOfCells + 8) / 8 * 8;
+        cellTypes.assign(paddedCellsNb, Cell::Nothing);
+        initialResources.assign(paddedCellsNb, 0);
+        for (BoundedVector<int, kCellsCapacity>& dirNeighs : neighs)
+        {
+            dirNeighs.assign(paddedCellsNb, numberOfCells);
+        }
+        curResources.assign(paddedCellsNb, 0);
+        myAnts.assign(paddedCellsNb, 0);
+        oppAnts.assign(paddedCellsNb, 0);
+        colonyParents.assign(paddedCellsNb, 0);
+        colonySizes.assign(paddedCellsNb, 0);
+        colonyIds.assign(paddedCellsNb, 0);
+        invalidateTurnState();
+    }
+
+    // synthetic data from cells types and resources
+    void finishInit()
+    {
+        crystalCells.resize(numberOfCells);
+        eggsCells.resize(numberOfCells);
+        totalCrystalsNb = 0;
+        totalEggsNb = 0;
+        for (int i = 0; i < numberOfCells; i++)
+        {
+            if (cellTypes[i] == Cell::Crystal)
+            {
+                crystalCells.insert(i);
+                totalCrystalsNb += initialResources[i];
+
+            }
+
+            if (cellTypes[i] == Cell::Egg)
+            {
+                eggsCells.insert(i);
+                totalEggsNb += initialResources[i];
+            }
+        }
+
+        eggsEstimation = float(totalCrystalsNb) / float(totalEggsNb);
+    }
+
+    static constexpr uint16_t kUnreachableDist = 0xFFFF;
+    static constexpr uint8_t kNoDir = 0xFF;
+
+    // iterator over the shortest path cells from the destination back to the first cell after the source,
+    // the path lies in the BFS tree of the source like the paths of the first search from it
+    struct PathIterator
+    {
+        const BasicField* field;
+        int curCell;
+        int srcCell;
+
+        int operator*() const { return curCell; }
+        bool operator!=(const PathIterator& other) const { return curCell != other.curCell; }
+        bool operator==(const PathIterator& other) const { return curCell == other.curCell; }
+        PathIterator& operator++()
+        {
+            const int nextCell = field->nextCell(curCell, srcCell);
+            curCell = nextCell == srcCell ? -1 : nextCell;
+            return *this;
+        }
+    };
+
+    // cells of the shortest path from srcCell to dstCell without srcCell, rebuilt on demand from next-hop table
+    struct PathRange
+    {
+        const BasicField* field;
+        int srcCell;
+        int dstCell;
+
+        PathIterator begin() const
+        {
+            if (srcCell == dstCell || field->dist(srcCell, dstCell) == kUnreachableDist)
+            {
+                return end();
+            }
+            return { field, dstCell, srcCell };
+        }
+        PathIterator end() const { return { field, -1, srcCell }; }
+        int size() const { return srcCell == dstCell ? 0 : field->dist(srcCell, dstCell); }
+    };
+
+    int dist(int srcCell, int dstCell) const
+    {
+        return distances[size_t(srcCell) * numberOfCells + dstCell];
+    }
+
+    int nextCell(int srcCell, int dstCell) const
+    {
+        return neighs[nextDirs[size_t(srcCell) * numberOfCells + dstCell]][srcCell];
+    }
+
+    PathRange path(int srcCell, int dstCell) const
+    {
+        return { this, srcCell, dstCell };
+    }
+
+    void calcDistances()
+    {
+        distances.assign(size_t(numberOfCells) * numberOfCells, kUnreachableDist);
+        nextDirs.assign(size_t(numberOfCells) * numberOfCells, kNoDir);
+        bfsQueue.reset(numberOfCells);
+
+        detectMirrorCells();
+
+        for (int cellIdx = 0; cellIdx < numberOfCells; cellIdx++)
+        {
+            // half of the tables is the reflection of the other one
+            if (!mirrorCells.empty() && mirrorCells[cellIdx] < cellIdx)
+            {
+                mirrorPathMap(mirrorCells[cellIdx], cellIdx);
+                continue;
+            }
+            makePathMap(cellIdx);
+        }
+
+        // std::cerr << "Max field distance: " << maxFieldDist << std::endl;
+    }
+
+    // contest maps are point-symmetric, mirrored cells are stored in pairs:
+    // either (0, 1), (2, 3), ... or center cell 0 and then (1, 2), (3, 4), ...
+    void detectMirrorCells()
+    {
+        mirrorCells.resize(numberOfCells);
+
+        for (int centerCells = 0; centerCells < 2; centerCells++)
+        {
+            for (int cellIdx = 0; cellIdx < numberOfCells; cellIdx++)
+            {
+                mirrorCells[cellIdx] = cellIdx < centerCells ? cellIdx : ((cellIdx - centerCells) ^ 1) + centerCells;
+            }
+
+            if (isMirrorSymmetric())
+            {
+                return;
+            }
+        }
+
+        mirrorCells.clear();
+    }
+
+    // reflection maps neighbour in direction d to the mirror's neighbour in opposite direction
+    bool isMirrorSymmetric() const
+    {
+        for (int cellIdx = 0; cellIdx < numberOfCells; cellIdx++)
+        {
+            const int mirrorCell = mirrorCells[cellIdx];
+            if (mirrorCell >= numberOfCells)
+            {
+                return false;
+            }
+
+            for (int nCnt = 0; nCnt < 6; nCnt++)
+            {
+                const int neighCell = neighs[nCnt][cellIdx];
+                const int mirrorNeighCell = neighs[(nCnt + 3) % 6][mirrorCell];
+                if (neighCell == numberOfCells ? mirrorNeighCell != numberOfCells : mirrorNeighCell != mirrorCells[neighCell])
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // single BFS from startCell, fills distances row and nextDirs column of startCell
+    void makePathMap(int startCell)
+    {
+        uint16_t* distRow = &distances[size_t(startCell) * numberOfCells];
+        distRow[startCell] = 0;
+
+        // graph is undirected: first step from a cell to startCell goes to its neighbour one step closer to startCell;
+        // among such neighbours the one of the first mirror pair is taken, from the two cells of a pair - the one
+        // with the parity of the cell (of startCell for the center cell); the reflection keeps pairs and flips
+        // parities, so the choice commutes with it and reflected tables are the same as BFS ones
+        const int centerCells = !mirrorCells.empty() && mirrorCells[0] == 0 ? 1 : 0;
+        const int startParity = (startCell - centerCells) & 1;
+
+        bfsQueue.clear();
+        bfsQueue.push(startCell);
+        while (!bfsQueue.empty())
+        {
+            const int cellToPromoute = bfsQueue.pop();
+            const uint16_t curDist = distRow[cellToPromoute];
+            const int parity = cellToPromoute < centerCells ? startParity : (cellToPromoute - centerCells) & 1;
+
+            uint8_t nextDir = kNoDir;
+            int nextDirOrder = std::numeric_limits<int>::max();
+            for (int nCnt = 0; nCnt < 6; nCnt++)
+            {
+                const int neighCell = neighs[nCnt][cellToPromoute];
+                if (neighCell == numberOfCells)
+                {
+                    continue;
+                }
+
+                if (distRow[neighCell] == kUnreachableDist)
+                {
+                    distRow[neighCell] = curDist + 1;
+                    bfsQueue.push(neighCell);
+                }
+                else if (distRow[neighCell] + 1 == curDist)
+                {
+                    const int pairCell = neighCell - centerCells;
+                    const int order = pairCell < 0 ? -1 : (pairCell & ~1) | ((pairCell & 1) ^ parity);
+                    if (order < nextDirOrder)
+                    {
+                        nextDirOrder = order;
+                        nextDir = uint8_t(nCnt);
+                    }
+                }
+            }
+            nextDirs[size_t(cellToPromoute) * numberOfCells + startCell] = nextDir;
+
+            if (curDist > maxFieldDist)
+            {
+                maxFieldDist = curDist;
+            }
+        }
+    }
+
+    // fill tables of mirrorStartCell by reflection of already built tables of startCell
+    void mirrorPathMap(int startCell, int mirrorStartCell)
+    {
+        const uint16_t* distRow = &distances[size_t(startCell) * numberOfCells];
+        uint16_t* mirrorDistRow = &distances[size_t(mirrorStartCell) * numberOfCells];
+
+        for (int cellIdx = 0; cellIdx < numberOfCells; cellIdx++)
+        {
+            const int mirrorCell = mirrorCells[cellIdx];
+            mirrorDistRow[mirrorCell] = distRow[cellIdx];
+
+            const uint8_t dir = nextDirs[size_t(cellIdx) * numberOfCells + startCell];
+            nextDirs[size_t(mirrorCell) * numberOfCells + mirrorStartCell] = dir == kNoDir ? kNoDir : uint8_t((dir + 3) % 6);
+        }
+    }
+
+    void readTurnState(InputReader& input)
+    {
+        for (int cellIdx = 0; cellIdx < numberOfCells; cellIdx++)
+        {
+            curResources[cellIdx] = input.readInt();
+            myAnts[cellIdx] = input.readInt();
+            oppAnts[cellIdx] = input.readInt();
+        }
+
+        finishTurnState();
+    }
+
+    void saveSnapshot(FieldSnapshot& snapshot) const
+    {
+        snapshot.curResources.assign(curResources.begin(), curResources.begin() + numberOfCells);
+        snapshot.myAnts.assign(myAnts.begin(), myAnts.begin() + numberOfCells);
+        snapshot.oppAnts.assign(oppAnts.begin(), oppAnts.begin() + numberOfCells);
+        snapshot.eggsCells = eggsCells;
+        snapshot.crystalCells = crystalCells;
+    }
+
+    // turn state from the snapshot of the same map, instead of readTurnState
+    void loadSnapshot(const FieldSnapshot& snapshot)
+    {
+        invalidateTurnState();
+        std::copy(snapshot.curResources.begin(), snapshot.curResources.end(), curResources.begin());
+        std::copy(snapshot.myAnts.begin(), snapshot.myAnts.end(), myAnts.begin());
+        std::copy(snapshot.oppAnts.begin(), snapshot.oppAnts.end(), oppAnts.begin());
+        eggsCells = snapshot.eggsCells;
+        crystalCells = snapshot.crystalCells;
+
+        finishTurnState();
+    }
+
+    // next turn state isn't a continuation of the current one: everything is recomputed from zero
+    void invalidateTurnState()
+    {
+        prevResources.assign(paddedCellsNb, 0);
+        prevMyAnts.assign(paddedCellsNb, 0);
+        prevOppAnts.assign(paddedCellsNb, 0);
+        dirtyCells.clear();
+        isTurnStateInvalid = true;
+
+        friendlyCellsOnTurn.resize(numberOfCells);
+        friendlyAntsOnCurTurn = 0;
+        onTurnMapCrystalsNb = 0;
+        onTurnMapEggsNb = 0;
+
+        resetColonyContainers();
+        colonizedCells.resize(numberOfCells);
+        nextColonyId = 1;
+        areColoniesDirty = true;
+    }
+
+    // turn data which is derived from curResources, myAnts and oppAnts, updated at cells changed since the previous turn
+    void finishTurnState()
+    {
+        dirtyCells.clear();
+        for (int cellIdx = 0; cellIdx < numberOfCells; cellIdx++)
+        {
+            if (isTurnStateInvalid || curResources[cellIdx] != prevResources[cellIdx]
+                || myAnts[cellIdx] != prevMyAnts[cellIdx] || oppAnts[cellIdx] != prevOppAnts[cellIdx])
+            {
+                dirtyCells.push_back(cellIdx);
+            }
+        }
+        isTurnStateInvalid = false;
+
+        for (int cellIdx : dirtyCells)
+        {
+            friendlyAntsOnCurTurn += myAnts[cellIdx] - prevMyAnts[cellIdx];
+            if ((myAnts[cellIdx] != 0) != (prevMyAnts[cellIdx] != 0))
+            {
+                if (myAnts[cellIdx])
+                {
+                    friendlyCellsOnTurn.insert(cellIdx);
+                }
+                else
+                {
+                    friendlyCellsOnTurn.erase(cellIdx);
+                }
+                areColoniesDirty = true;
+            }
+
+            // resource cells which are still on the map, the forgotten ones are empty
+            if (eggsCells.count(cellIdx))
+            {
+                onTurnMapEggsNb += curResources[cellIdx] - prevResources[cellIdx];
+            }
+            if (crystalCells.count(cellIdx))
+            {
+                onTurnMapCrystalsNb += curResources[cellIdx] - prevResources[cellIdx];
+            }
+
+            prevResources[cellIdx] = curResources[cellIdx];
+            prevMyAnts[cellIdx] = myAnts[cellIdx];
+            prevOppAnts[cellIdx] = oppAnts[cellIdx];
+        }
+    }
+
+    int findColonyRoot(int cell)
+    {
+        // path halving
+        while (colonyParents[cell] != cell)
+        {
+            colonyParents[cell] = colonyParents[colonyParents[cell]];
+            cell = colonyParents[cell];
+        }
+        return cell;
+    }
+
+    int colonyIdOf(int cell)
+    {
+        return colonyIds[findColonyRoot(cell)];
+    }
+
+    // union by size, the colony keeps the older id; zero id of a new cell is no id
+    void uniteColonies(int cell1, int cell2)
+    {
+        int root1 = findColonyRoot(cell1),
+            root2 = findColonyRoot(cell2);
+        if (root1 == root2)
+        {
+            return;
+        }
+        if (colonySizes[root1] < colonySizes[root2])
+        {
+            std::swap(root1, root2);
+        }
+        colonyParents[root2] = root1;
+        colonySizes[root1] += colonySizes[root2];
+
+        const int id1 = colonyIds[root1],
+                  id2 = colonyIds[root2];
+        const int keptId = !id1 || (id2 && id2 < id1) ? id2 : id1;
+        const int goneId = keptId == id1 ? id2 : id1;
+        colonyIds[root1] = keptId;
+        if (goneId)
+        {
+            markColonyUpdate(goneId, -1, ColonyRebuilt);
+        }
+        if (keptId)
+        {
+            markColonyUpdate(keptId, cell1, ColonyGrown);
+        }
+    }
+
+    void markColonyUpdate(int colonyId, int memberCell, ColonyChange change)
+    {
+        auto updateIter = colonyUpdatesMap.find(colonyId);
+        if (updateIter == colonyUpdatesMap.end())
+        {
+            colonyUpdatesMap.emplace(colonyId, ColonyUpdate{ memberCell, change });
+            return;
+        }
+        updateIter->second.memberCell = memberCell;
+        updateIter->second.change = std::max(updateIter->second.change, change);
+    }
+
+    void addColonyCell(int cell)
+    {
+        colonizedCells.insert(cell);
+        colonyParents[cell] = cell;
+        colonySizes[cell] = 1;
+        colonyIds[cell] = 0;
+        for (const BoundedVector<int, kCellsCapacity>& dirNeighs : neighs)
+        {
+            const int neighCell = dirNeighs[cell];
+            if (neighCell != numberOfCells && colonizedCells.count(neighCell))
+            {
+                uniteColonies(cell, neighCell);
+            }
+        }
+
+        const int root = findColonyRoot(cell);
+        if (!colonyIds[root])
+        {
+            colonyIds[root] = nextColonyId++;
+            markColonyUpdate(colonyIds[root], cell, ColonyRebuilt);
+        }
+    }
+
+    bool isFriendlyBase(int cell) const
+    {
+        return std::find(friendlyBases.begin(), friendlyBases.end(), cell) != friendlyBases.end();
+    }
+
+    // rest of every colony with removed cells is reached by BFS from the neighbours of removed cells,
+    // every connected part becomes a colony; the old id goes to the part with a friendly base or to the biggest part
+    void removeColonyCells(const CellSet& removedCells, ArenaVector<int>& reachedCells)
+    {
+        // parts are found on the old union-find, so old ids are known until the parts are relinked
+        struct ColonyPart
+        {
+            int firstIdx;
+            int endIdx;
+            int oldId;
+            bool hasFriendlyBase;
+        };
+        ArenaVector<ColonyPart> parts{ ArenaAllocator<ColonyPart>(&turnArena) };
+
+        for (int cell : removedCells)
+        {
+            markColonyUpdate(colonyIdOf(cell), -1, ColonyRebuilt);
+            colonizedCells.erase(cell);
+        }
+
+        CellSet visitedCells(numberOfCells, &turnArena);
+        reachedCells.clear();
+        for (int removedCell : removedCells)
+        {
+            for (const BoundedVector<int, kCellsCapacity>& dirNeighs : neighs)
+            {
+                const int startCell = dirNeighs[removedCell];
+                if (startCell == numberOfCells || !colonizedCells.count(startCell) || visitedCells.count(startCell))
+                {
+                    continue;
+                }
+
+                ColonyPart part{ int(reachedCells.size()), 0, colonyIdOf(startCell), false };
+                visitedCells.insert(startCell);
+                reachedCells.push_back(startCell);
+                for (size_t reachedIdx = size_t(part.firstIdx); reachedIdx < reachedCells.size(); reachedIdx++)
+                {
+                    const int cell = reachedCells[reachedIdx];
+                    part.hasFriendlyBase = part.hasFriendlyBase || isFriendlyBase(cell);
+                    for (const BoundedVector<int, kCellsCapacity>& cellNeighs : neighs)
+                    {
+                        const int neighCell = cellNeighs[cell];
+                        if (neighCell != numberOfCells && colonizedCells.count(neighCell) && !visitedCells.count(neighCell))
+                        {
+                            visitedCells.insert(neighCell);
+                            reachedCells.push_back(neighCell);
+                        }
+                    }
+                }
+                part.endIdx = int(reachedCells.size());
+                parts.push_back(part);
+            }
+        }
+
+        auto isBetterPart = [](const ColonyPart& lhs, const ColonyPart& rhs)
+        {
+            if (lhs.hasFriendlyBase != rhs.hasFriendlyBase)
+            {
+                return lhs.hasFriendlyBase;
+            }
+            return lhs.endIdx - lhs.firstIdx > rhs.endIdx - rhs.firstIdx;
+        };
+
+        for (size_t partIdx = 0; partIdx < parts.size(); partIdx++)
+        {
+            const ColonyPart& part = parts[partIdx];
+            bool isIdKeeper = true;
+            for (size_t otherIdx = 0; otherIdx < parts.size() && isIdKeeper; otherIdx++)
+            {
+                const ColonyPart& other = parts[otherIdx];
+                if (other.oldId == part.oldId && otherIdx != partIdx
+                    && (isBetterPart(other, part) || (otherIdx < partIdx && !isBetterPart(part, other))))
+                {
+                    isIdKeeper = false;
+                }
+            }
+
+            const int root = reachedCells[part.firstIdx];
+            for (int reachedIdx = part.firstIdx; reachedIdx < part.endIdx; reachedIdx++)
+            {
+                colonyParents[reachedCells[reachedIdx]] = root;
+            }
+            colonySizes[root] = part.endIdx - part.firstIdx;
+            colonyIds[root] = isIdKeeper ? part.oldId : nextColonyId++;
+            markColonyUpdate(colonyIds[root], root, ColonyRebuilt);
+        }
+    }
+
+    // cells of the updated colony by BFS from its member, distances to the colony are relaxed
+    // or computed anew; false when the colony has no friendly base
+    bool collectColony(int colonyId, ColonyUpdate& update, ArenaVector<int>& reachedCells)
+    {
+        auto colonyIter = turnColoniesMap.find(colonyId);
+        if (colonyIter == turnColoniesMap.end())
+        {
+            colonyIter = turnColoniesMap.emplace(colonyId, CellSet(numberOfCells, &colonyArena)).first;
+            update.change = ColonyRebuilt;
+        }
+        CellSet& colonyCells = colonyIter->second;
+        colonyCells.clear();
+
+        bool hasFriendlyBase = false;
+        colonyCells.insert(update.memberCell);
+        reachedCells.assign(1, update.memberCell);
+        for (size_t reachedIdx = 0; reachedIdx < reachedCells.size(); reachedIdx++)
+        {
+            const int cell = reachedCells[reachedIdx];
+            hasFriendlyBase = hasFriendlyBase || isFriendlyBase(cell);
+            for (const BoundedVector<int, kCellsCapacity>& dirNeighs : neighs)
+            {
+                const int neighCell = dirNeighs[cell];
+                if (neighCell != numberOfCells && colonizedCells.count(neighCell) && !colonyCells.count(neighCell))
+                {
+                    colonyCells.insert(neighCell);
+                    reachedCells.push_back(neighCell);
+                }
+            }
+        }
+        if (!hasFriendlyBase)
+        {
+            return false;
+        }
+
+        // new sources only decrease distances, so grown colony keeps its distance field
+        DistanceField& colonyDistField = this->colonyDistField(colonyId);
+        if (update.change == ColonyRebuilt)
+        {
+            colonyDistField.reset(numberOfCells);
+        }
+        for (int colonyCell : colonyCells)
+        {
+            colonyDistField.addSource(colonyCell);
+        }
+        colonyDistField.propagate(neighs);
+        return true;
+    }
+
+    void eraseColony(int colonyId)
+    {
+        turnColoniesMap.erase(colonyId);
+        colonyDistFieldMap.erase(colonyId);
+        colonyCellWorthsMap.erase(colonyId);
+        colonyDiffusedWorthsMap.erase(colonyId);
+        coloniesLinesMap.erase(colonyId);
+        coloniesLinesCellsMap.erase(colonyId);
+        coloniesBeaconsSetMap.erase(colonyId);
+    }
+
+    // all colonies are collected anew from the union-find
+    void compactColonies()
+    {
+        resetColonyContainers();
+        for (int friendlyBase : friendlyBases)
+        {
+            if (colonizedCells.count(friendlyBase))
+            {
+                markColonyUpdate(colonyIdOf(friendlyBase), friendlyBase, ColonyRebuilt);
+            }
+        }
+    }
+
+    // per-turn containers are dropped together with the arena memory at the start of the turn
+    void resetTurnContainers()
+    {
+        worthCandidatesColonyMap.clear();
+        colonyUpdatesMap.clear();
+        turnArena.reset();
+    }
+
+    void resetColonyContainers()
+    {
+        turnColoniesMap.clear();
+        colonyDistFieldMap.clear();
+        colonyCellWorthsMap.clear();
+        colonyDiffusedWorthsMap.clear();
+        coloniesLinesMap.clear();
+        coloniesLinesCellsMap.clear();
+        coloniesBeaconsSetMap.clear();
+        colonyArena.reset();
+        colonyArenaLimit = 0;
+    }
+
+    // per-colony containers of the turn, created in the arena on the first access
+    CandidateList& colonyCandidates(int colonyId)
+    {
+        return turnMapEntry(worthCandidatesColonyMap, colonyId, &turnArena);
+    }
+
+    // per-colony containers which are kept between turns
+    ArenaMap<int, int>& colonyLines(int colonyId)
+    {
+        return turnMapEntry(coloniesLinesMap, colonyId, ArenaAllocator<std::pair<const int, int>>(&colonyArena));
+    }
+
+    CellSet& colonyLinesCells(int colonyId)
+    {
+        return turnMapEntry(coloniesLinesCellsMap, colonyId, numberOfCells, &colonyArena);
+    }
+
+    CellSet& colonyBeacons(int colonyId)
+    {
+        return turnMapEntry(coloniesBeaconsSetMap, colonyId, numberOfCells, &colonyArena);
+    }
+
+    DistanceField& colonyDistField(int colonyId)
+    {
+        return turnMapEntry(colonyDistFieldMap, colonyId, &colonyArena);
+    }
+
+    ArenaVector<float>& colonyCellWorths(int colonyId)
+    {
+        return turnMapEntry(colonyCellWorthsMap, colonyId, ArenaAllocator<float>(&colonyArena));
+    }
+
+    ArenaVector<float>& colonyDiffusedWorths(int colonyId)
+    {
+        return turnMapEntry(colonyDiffusedWorthsMap, colonyId, ArenaAllocator<float>(&colonyArena));
+    }
+
+    // lines of the previous turn are still actual when neither the colony nor its resource cells have changed
+    bool areColonyLinesActual(int colonyId, const CellSet& colonyCells) const
+    {
+        if (colonyUpdatesMap.count(colonyId) || !coloniesLinesCellsMap.count(colonyId))
+        {
+            return false;
+        }
+        for (int cell : dirtyCells)
+        {
+            if (cellTypes[cell] != Cell::Nothing && curResources[cell] == 0 && colonyCells.count(cell))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    //         turnColoniesMap  
+    void buildColonies()
+    {
+        resetTurnContainers();
+
+        if (!colonyArenaLimit)
+        {
+            colonyArenaLimit = colonyArena.usedBytes() ? 2 * colonyArena.usedBytes() + TurnArena::kMinBlockSize : 0;
+        }
+        else if (colonyArena.usedBytes() > colonyArenaLimit)
+        {
+            compactColonies();
+        }
+
+        ArenaVector<int> reachedCells{ ArenaAllocator<int>(&turnArena) };
+        reachedCells.reserve(numberOfCells);
+        if (areColoniesDirty)
+        {
+            CellSet removedCells(numberOfCells, &turnArena);
+            removedCells |= colonizedCells;
+            removedCells -= friendlyCellsOnTurn;
+            if (!removedCells.empty())
+            {
+                removeColonyCells(removedCells, reachedCells);
+            }
+
+            CellSet addedCells(numberOfCells, &turnArena);
+            addedCells |= friendlyCellsOnTurn;
+            addedCells -= colonizedCells;
+            for (int cell : addedCells)
+            {
+                addColonyCell(cell);
+            }
+            areColoniesDirty = false;
+        }
+
+        for (auto& updatePair : colonyUpdatesMap)
+        {
+            const int colonyId = updatePair.first;
+            ColonyUpdate& update = updatePair.second;
+            const bool isColonyAlive = update.memberCell != -1 && colonyIdOf(update.memberCell) == colonyId;
+            if (!isColonyAlive || !collectColony(colonyId, update, reachedCells))
+            {
+                eraseColony(colonyId);
+            }
+        }
+
+        for (const auto& colonyPair : turnColoniesMap)
+        {
+            if (!isDebugLogEnabled)
+            {
+                break;
+            }
+
+            std::cerr << "Colony " << colonyPair.first << ": [";
+            bool isFirstCell = true;
+            for (int cell : colonyPair.second)
+            {
+                std::cerr << (isFirstCell ? "" : ", ") << cell;
+                isFirstCell = false;
+            }
+            std::cerr << "]\n";
+        }
+    }
+
+    // resources never come back, so the cells which became empty are forgotten for the rest of the game;
+    // only dirty cells may become empty
+    void forgetEmptyResourceCells()
+    {
+//         ,     
+        for (int cell : dirtyCells)
+        {
+            if (curResources[cell] == 0)
+            {
+                eggsCells.erase(cell);
+                crystalCells.erase(cell);
+            }
+        }
+    }
+
+    // worth of the colony target cell, zero for all other cells
+    float cellWorth(int cell, const DistanceField& colonyDistField) const
+    {
+        // dist to nearest friendly cell IN THIS COLONY from this cell
+        const int distFromNearestColonyCell = colonyDistField.dists[cell];
+        if (eggsCells.count(cell))
+        {
+            float distCoef = distFromNearestColonyCell == 0 ? 2 : (1 / float(distFromNearestColonyCell));
+            return float(curResources[cell] * eggsEstimation) * distCoef;
+        }
+        if (crystalCells.count(cell))
+        {
+            float distCoef = distFromNearestColonyCell == 0 ? 0.5f : (1 / float(distFromNearestColonyCell));
+            return float(curResources[cell] * crystallEstimation) * distCoef;
+        }
+        return 0.f;
+    }
+
+    // new worth of the cell, diffused worths are updated at the cell and its neighbours
+    void updateCellWorth(int cell, const DistanceField& colonyDistField, ArenaVector<float>& cellWorths, ArenaVector<float>& diffusedCellWorths) const
+    {
+        const float worth = cellWorth(cell, colonyDistField);
+        if (worth == cellWorths[cell])
+        {
+            return;
+        }
+        cellWorths[cell] = worth;
+        diffusedCellWorths[cell] = diffuseCellWorth(cellWorths.data(), neighs, cell, kNeighWorthsCoef);
+        for (const BoundedVector<int, kCellsCapacity>& dirNeighs : neighs)
+        {
+            const int neighCell = dirNeighs[cell];
+            if (neighCell != numberOfCells)
+            {
+                diffusedCellWorths[neighCell] = diffuseCellWorth(cellWorths.data(), neighs, neighCell, kNeighWorthsCoef);
+            }
+        }
+    }
+
+    // worths of updated colonies are computed from scratch, other colonies update worths of dirty cells
+    // and, when the crystals estimation has changed, of all crystal cells
+    void makeTurnEstimation()
+    {
+        forgetEmptyResourceCells();
+
+//   
+//       -   
+        crystallEstimation = float(totalCrystalsNb) / float(onTurnMapCrystalsNb);
+
+//   -       
+//      
+        if (friendlyAntsOnCurTurn > totalCrystalsNb / 2)
+        {
+            crystallEstimation *= 10;
+        }
+
+        const bool isCrystallEstimationChanged = crystallEstimation != worthsCrystallEstimation;
+        worthsCrystallEstimation = crystallEstimation;
+
+        const int candidatesNb = eggsCells.size() + crystalCells.size();
+
+//      
+        for (const auto& colonyWorthMapPair : turnColoniesMap)
+        {
+            const int colonyId = colonyWorthMapPair.first;
+
+            DistanceField& colonyDistField = this->colonyDistField(colonyId);
+            ArenaVector<float>& cellWorths = colonyCellWorths(colonyId);
+            ArenaVector<float>& diffusedCellWorths = colonyDiffusedWorths(colonyId);
+            if (colonyUpdatesMap.count(colonyId))
+            {
+                // worths of target cells, all other cells are zero
+                cellWorths.assign(paddedCellsNb, 0.f);
+                for (int eggCell : eggsCells)
+                {
+                    cellWorths[eggCell] = cellWorth(eggCell, colonyDistField);
+                }
+                for (int crystalCell : crystalCells)
+                {
+                    cellWorths[crystalCell] = cellWorth(crystalCell, colonyDistField);
+                }
+
+    //                 
+                //        
+                diffusedCellWorths.resize(paddedCellsNb);
+                diffuseCellWorths(cellWorths.data(), neighs, diffusedCellWorths.data(), paddedCellsNb, kNeighWorthsCoef);
+            }
+            else
+            {
+                if (isCrystallEstimationChanged)
+                {
+                    for (int crystalCell : crystalCells)
+                    {
+                        updateCellWorth(crystalCell, colonyDistField, cellWorths, diffusedCellWorths);
+                    }
+                }
+                for (int cell : dirtyCells)
+                {
+                    updateCellWorth(cell, colonyDistField, cellWorths, diffusedCellWorths);
+                }
+            }
+
+            CandidateList& colonyCandidates = this->colonyCandidates(colonyId);
+            colonyCandidates.clear();
+            colonyCandidates.reserve(candidatesNb);
+
+            //     
+            for (int eggCell : eggsCells)
+            {
+                colonyCandidates.add(diffusedCellWorths[eggCell], eggCell);
+            }
+            for (int crystalCell : crystalCells)
+            {
+                colonyCandidates.add(diffusedCellWorths[crystalCell], crystalCell);
+            }
+
+    // print estimation
+            if (isDebugLogEnabled)
+            {
+                std::cerr << "Estimation for colony " << colonyId << ": ";
+                for (const ScoredCell& candidate : colonyCandidates.items)
+                {
+                    std::cerr << candidate.cell << " (" << candidate.score << "), ";
+                }
+                std::cerr << std::endl;
+            }
+
+            colonyCandidates.buildHeap();
+        }
+
+#ifdef SPRING_CHALLENGE_CHECK_INCREMENTAL
+        checkIncrementalState();
+#endif
+    }
+
+#ifdef SPRING_CHALLENGE_CHECK_INCREMENTAL
+    static void checkIncremental(bool isSame, const char* what)
+    {
+        if (!isSame)
+        {
+            std::cerr << "Incremental turn state differs from full recompute: " << what << std::endl;
+            std::abort();
+        }
+    }
+
+    // everything which is updated at dirty cells is recomputed from the turn input and compared
+    void checkIncrementalState() const
+    {
+        int antsNb = 0;
+        std::vector<int> friendlyCells;
+        for (int cell = 0; cell < numberOfCells; cell++)
+        {
+            if (myAnts[cell])
+            {
+                antsNb += myAnts[cell];
+                friendlyCells.push_back(cell);
+            }
+            checkIncremental(curResources[cell] > 0 || (!eggsCells.count(cell) && !crystalCells.count(cell)), "empty resource cells");
+        }
+        checkIncremental(antsNb == friendlyAntsOnCurTurn, "friendly ants");
+        checkIncremental(std::equal(friendlyCells.begin(), friendlyCells.end(), friendlyCellsOnTurn.begin())
+            && int(friendlyCells.size()) == friendlyCellsOnTurn.size(), "friendly cells");
+
+        int eggsNb = 0;
+        int crystalsNb = 0;
+        for (int eggCell : eggsCells)
+        {
+            eggsNb += curResources[eggCell];
+        }
+        for (int crystalCell : crystalCells)
+        {
+            crystalsNb += curResources[crystalCell];
+        }
+        checkIncremental(eggsNb == onTurnMapEggsNb && crystalsNb == onTurnMapCrystalsNb, "resources on the map");
+
+        // colonies are the connected parts of friendly cells with a friendly base, every part
+        // is labelled by BFS; union-find keeps the same id for all cells of the part
+        checkIncremental(std::equal(friendlyCells.begin(), friendlyCells.end(), colonizedCells.begin())
+            && int(friendlyCells.size()) == colonizedCells.size(), "colonized cells");
+        std::vector<int> cellParts(numberOfCells, 0);
+        std::vector<int> partSizes(1, 0);
+        std::vector<int> reachedCells;
+        int basedPartsNb = 0;
+        for (int startCell : friendlyCells)
+        {
+            if (cellParts[startCell])
+            {
+                continue;
+            }
+            const int part = int(partSizes.size());
+            bool hasFriendlyBase = false;
+            cellParts[startCell] = part;
+            reachedCells.assign(1, startCell);
+            for (size_t reachedIdx = 0; reachedIdx < reachedCells.size(); reachedIdx++)
+            {
+                hasFriendlyBase = hasFriendlyBase || isFriendlyBase(reachedCells[reachedIdx]);
+                for (const BoundedVector<int, kCellsCapacity>& dirNeighs : neighs)
+                {
+                    const int neighCell = dirNeighs[reachedCells[reachedIdx]];
+                    if (neighCell != numberOfCells && myAnts[neighCell] && !cellParts[neighCell])
+                    {
+                        cellParts[neighCell] = part;
+                        reachedCells.push_back(neighCell);
+                    }
+                }
+            }
+            partSizes.push_back(int(reachedCells.size()));
+            basedPartsNb += hasFriendlyBase;
+
+            int partRoot = startCell;
+            while (colonyParents[partRoot] != partRoot)
+            {
+                partRoot = colonyParents[partRoot];
+            }
+            for (int cell : reachedCells)
+            {
+                int root = cell;
+                while (colonyParents[root] != root)
+                {
+                    root = colonyParents[root];
+                }
+                checkIncremental(root == partRoot, "colony roots");
+            }
+            checkIncremental(colonySizes[partRoot] == int(reachedCells.size()), "colony sizes");
+            checkIncremental(turnColoniesMap.count(colonyIds[partRoot]) == size_t(hasFriendlyBase), "colony ids");
+        }
+        checkIncremental(int(turnColoniesMap.size()) == basedPartsNb, "colonies number");
+
+        // data of the colonies which are gone is erased with them, so a new colony never picks up
+        // lines or beacons left under its id
+        auto areColonyKeys = [this](const auto& colonyDataMap)
+        {
+            for (const auto& colonyDataPair : colonyDataMap)
+            {
+                if (!turnColoniesMap.count(colonyDataPair.first))
+                {
+                    return false;
+                }
+            }
+            return true;
+        };
+        checkIncremental(areColonyKeys(coloniesLinesMap) && areColonyKeys(coloniesLinesCellsMap) && areColonyKeys(coloniesBeaconsSetMap)
+            && areColonyKeys(colonyDistFieldMap) && areColonyKeys(colonyCellWorthsMap) && areColonyKeys(colonyDiffusedWorthsMap), "colony data keys");
+
+        std::vector<float> cellWorths(paddedCellsNb);
+        std::vector<float> diffusedCellWorths(paddedCellsNb);
+        for (const auto& colonyPair : turnColoniesMap)
+        {
+            const int part = cellParts[*colonyPair.second.begin()];
+            for (int cell : colonyPair.second)
+            {
+                checkIncremental(cellParts[cell] == part, "colony cells");
+            }
+            checkIncremental(colonyPair.second.size() == partSizes[part], "colony cells");
+
+            DistanceField distField;
+            distField.reset(numberOfCells);
+            for (int colonyCell : colonyPair.second)
+            {
+                distField.addSource(colonyCell);
+            }
+            distField.propagate(neighs);
+            const DistanceField& colonyDistField = colonyDistFieldMap.at(colonyPair.first);
+            checkIncremental(std::equal(distField.dists.begin(), distField.dists.end(), colonyDistField.dists.begin()), "colony distances");
+
+            std::fill(cellWorths.begin(), cellWorths.end(), 0.f);
+            for (int eggCell : eggsCells)
+            {
+                cellWorths[eggCell] = cellWorth(eggCell, distField);
+            }
+            for (int crystalCell : crystalCells)
+            {
+                cellWorths[crystalCell] = cellWorth(crystalCell, distField);
+            }
+            diffuseCellWorths(cellWorths.data(), neighs, diffusedCellWorths.data(), paddedCellsNb, kNeighWorthsCoef);
+
+            const CandidateList& colonyCandidates = worthCandidatesColonyMap.at(colonyPair.first);
+            checkIncremental(int(colonyCandidates.items.size()) == eggsCells.size() + crystalCells.size(), "candidates number");
+            for (const ScoredCell& candidate : colonyCandidates.items)
+            {
+                checkIncremental(candidate.score == diffusedCellWorths[candidate.cell], "candidate worths");
+            }
+        }
+    }
+#endif
+};
+
+constexpr size_t TurnArena::kMinBlockSize;
+constexpr uint16_t DistanceField::kUnreachableDist;
+template <int MaxCells, int MaxBases>
+constexpr int BasicField<MaxCells, MaxBases>::kCellsCapacity;
+template <int MaxCells, int MaxBases>
+constexpr uint16_t BasicField<MaxCells, MaxBases>::kUnreachableDist;
+template <int MaxCells, int MaxBases>
+constexpr uint8_t BasicField<MaxCells, MaxBases>::kNoDir;
+template <int MaxCells, int MaxBases>
+constexpr float BasicField<MaxCells, MaxBases>::kNeighWorthsCoef;
+
+using Field = BasicField<kDynamicCapacity, kDynamicCapacity>;
+
+// binary log of the bot input: fixed header, raw init arrays, then one frame per turn.
+// All numbers are little-endian as written by the host.
+// Init: cell types (uint8), initial resources (int32), neighbours by direction (int32, -1 for none),
+// friendly and opponent bases (int32).
+// Turn frame: uint32 payload size, then varint number of changed cells and for every changed cell
+// varint gap to the previous changed cell and zigzag varint deltas of resources, my ants and opponent ants
+struct TurnLogHeader
+{
+    static constexpr uint32_t kMagic = 0x4C544353; // "SCTL"
+    static constexpr uint32_t kVersion = 1;
+
+    uint32_t magic;
+    uint32_t version;
+    uint32_t cellsNb;
+    uint32_t basesNb;
+};
+
+class TurnLogWriter
+{
+public:
+    ~TurnLogWriter()
+    {
+        if (file_)
+        {
+            std::fclose(file_);
+        }
+    }
+
+    bool open(const char* path)
+    {
+        file_ = std::fopen(path, "wb");
+        return file_ != nullptr;
+    }
+
+    template <int MaxCells, int MaxBases>
+    void writeInit(const BasicField<MaxCells, MaxBases>& field)
+    {
+        const TurnLogHeader header{ TurnLogHeader::kMagic, TurnLogHeader::kVersion,
+            uint32_t(field.numberOfCells), uint32_t(field.numberOfBases) };
+        std::fwrite(&header, sizeof(header), 1, file_);
+
+        const int cellsNb = field.numberOfCells;
+        std::vector<uint8_t> cellTypes(field.cellTypes.begin(), field.cellTypes.begin() + cellsNb);
+        std::fwrite(cellTypes.data(), 1, cellTypes.size(), file_);
+        writeInts(field.initialResources.data(), cellsNb);
+        for (const auto& dirNeighs : field.neighs)
+        {
+            std::vector<int32_t> neighCells(dirNeighs.begin(), dirNeighs.begin() + cellsNb);
+            std::replace(neighCells.begin(), neighCells.end(), int32_t(cellsNb), int32_t(-1));
+            writeInts(neighCells.data(), cellsNb);
+        }
+        writeInts(field.friendlyBases.data(), field.numberOfBases);
+        writeInts(field.opponentBases.data(), field.numberOfBases);
+
+        prevCellsData_.assign(size_t(cellsNb) * 3, 0);
+        std::fflush(file_);
+    }
+
+    template <int MaxCells, int MaxBases>
+    void writeTurn(const BasicField<MaxCells, MaxBases>& field)
+    {
+        changes_.clear();
+        int changedCellsNb = 0;
+        int prevChangedCell = -1;
+        for (int cell = 0; cell < field.numberOfCells; cell++)
+        {
+            int* prevCellData = &prevCellsData_[size_t(cell) * 3];
+            const int cellData[3] = { field.curResources[cell], field.myAnts[cell], field.oppAnts[cell] };
+            if (cellData[0] == prevCellData[0] && cellData[1] == prevCellData[1] && cellData[2] == prevCellData[2])
+            {
+                continue;
             }
-            
-    // estimate crystall cells
-            // std::cerr << "\tEstimate crystal cells" << std::endl;
-            for (int crystalCell : crystalCells)
+
+            appendVarint(changes_, uint32_t(cell - prevChangedCell - 1));
+            for (int valueIdx = 0; valueIdx < 3; valueIdx++)
+            {
+                const int32_t delta = cellData[valueIdx] - prevCellData[valueIdx];
+                appendVarint(changes_, (uint32_t(delta) << 1) ^ uint32_t(delta >> 31));
+                prevCellData[valueIdx] = cellData[valueIdx];
+            }
+            prevChangedCell = cell;
+            changedCellsNb++;
+        }
+
+        frame_.clear();
+        appendVarint(frame_, uint32_t(changedCellsNb));
+        frame_.insert(frame_.end(), changes_.begin(), changes_.end());
+
+        const uint32_t payloadSize = uint32_t(frame_.size());
+        std::fwrite(&payloadSize, sizeof(payloadSize), 1, file_);
+        std::fwrite(frame_.data(), 1, frame_.size(), file_);
+        // every turn is on the disk even if the process is killed by the referee
+        std::fflush(file_);
+    }
+
+private:
+    FILE* file_{ nullptr };
+    std::vector<int> prevCellsData_;
+    std::vector<uint8_t> changes_;
+    std::vector<uint8_t> frame_;
+
+    void writeInts(const int* values, int valuesNb)
+    {
+        static_assert(sizeof(int) == sizeof(int32_t), "log stores int as int32");
+        std::fwrite(values, sizeof(int32_t), size_t(valuesNb), file_);
+    }
+
+    static void appendVarint(std::vector<uint8_t>& bytes, uint32_t value)
+    {
+        while (value >= 0x80)
+        {
+            bytes.push_back(uint8_t(value | 0x80));
+            value >>= 7;
+        }
+        bytes.push_back(uint8_t(value));
+    }
+};
+
+// replays TurnLogWriter output: the file is mapped into memory and frames are decoded straight
+// into Field arrays, without any text parsing
+class TurnLogReader
+{
+public:
+    TurnLogReader() = default;
+    TurnLogReader(const TurnLogReader&) = delete;
+    TurnLogReader& operator=(const TurnLogReader&) = delete;
+
+    ~TurnLogReader()
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        if (data_ && !isBuffered_)
+        {
+            munmap(const_cast<uint8_t*>(data_), size_);
+        }
+#endif
+    }
+
+    // false when the file can't be read or isn't a turn log
+    bool open(const char* path)
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        const int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+        {
+            return false;
+        }
+        struct stat fileStat;
+        if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0)
+        {
+            size_ = size_t(fileStat.st_size);
+            void* mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            data_ = mapped == MAP_FAILED ? nullptr : static_cast<const uint8_t*>(mapped);
+        }
+        ::close(fd);
+#else
+        // without mmap the whole file is read into memory
+        if (FILE* file = std::fopen(path, "rb"))
+        {
+            char block[1 << 16];
+            size_t readNb;
+            while ((readNb = std::fread(block, 1, sizeof(block), file)) > 0)
+            {
+                buffer_.insert(buffer_.end(), block, block + readNb);
+            }
+            std::fclose(file);
+        }
+        data_ = buffer_.empty() ? nullptr : reinterpret_cast<const uint8_t*>(buffer_.data());
+        size_ = buffer_.size();
+        isBuffered_ = true;
+#endif
+        if (!data_ || size_ < sizeof(header_))
+        {
+            return false;
+        }
+        std::memcpy(&header_, data_, sizeof(header_));
+        pos_ = sizeof(header_);
+        return header_.magic == TurnLogHeader::kMagic && header_.version == TurnLogHeader::kVersion
+            && size_ - pos_ >= initSize();
+    }
+
+    const TurnLogHeader& header() const { return header_; }
+
+    // false when the map of the log doesn't fit the field or refers to missing cells
+    template <int MaxCells, int MaxBases>
+    bool initField(BasicField<MaxCells, MaxBases>& field)
+    {
+        const int cellsNb = int(header_.cellsNb);
+        const uint32_t maxCount = uint32_t(std::numeric_limits<int>::max());
+        if (header_.cellsNb > maxCount || header_.basesNb > maxCount
+            || !BasicField<MaxCells, MaxBases>::fitsMap(cellsNb, int(header_.basesNb)))
+        {
+            return false;
+        }
+        field.initCells(cellsNb);
+        for (int cell = 0; cell < cellsNb; cell++)
+        {
+            field.cellTypes[cell] = static_cast<Cell::Type>(data_[pos_ + cell]);
+        }
+        pos_ += cellsNb;
+        readInts(field.initialResources.data(), cellsNb);
+        for (auto& dirNeighs : field.neighs)
+        {
+            readInts(dirNeighs.data(), cellsNb);
+            std::replace(dirNeighs.begin(), dirNeighs.begin() + cellsNb, -1, cellsNb);
+        }
+
+        field.numberOfBases = int(header_.basesNb);
+        field.friendlyBases.resize(field.numberOfBases);
+        field.opponentBases.resize(field.numberOfBases);
+        readInts(field.friendlyBases.data(), field.numberOfBases);
+        readInts(field.opponentBases.data(), field.numberOfBases);
+        if (!field.areMapCellsValid())
+        {
+            return false;
+        }
+
+        field.finishInit();
+        cellsData_.assign(size_t(cellsNb) * 3, 0);
+        return true;
+    }
+
+    // false when frames are over or the last frame is cut
+    template <int MaxCells, int MaxBases>
+    bool readTurn(BasicField<MaxCells, MaxBases>& field)
+    {
+        uint32_t payloadSize;
+        if (size_ - pos_ < sizeof(payloadSize))
+        {
+            return false;
+        }
+        std::memcpy(&payloadSize, data_ + pos_, sizeof(payloadSize));
+        if (size_ - pos_ - sizeof(payloadSize) < payloadSize)
+        {
+            return false;
+        }
+        pos_ += sizeof(payloadSize);
+        const size_t frameEnd = pos_ + payloadSize;
+
+        const uint32_t changedCellsNb = readVarint(frameEnd);
+        int cell = -1;
+        for (uint32_t changeIdx = 0; changeIdx < changedCellsNb; changeIdx++)
+        {
+            cell += int(readVarint(frameEnd)) + 1;
+            if (cell >= int(header_.cellsNb))
+            {
+                break;
+            }
+            for (int valueIdx = 0; valueIdx < 3; valueIdx++)
+            {
+                const uint32_t zigzag = readVarint(frameEnd);
+                cellsData_[size_t(cell) * 3 + valueIdx] += int32_t(zigzag >> 1) ^ -int32_t(zigzag & 1);
+            }
+        }
+        pos_ = frameEnd;
+
+        for (int cellIdx = 0; cellIdx < field.numberOfCells; cellIdx++)
+        {
+            field.curResources[cellIdx] = cellsData_[size_t(cellIdx) * 3];
+            field.myAnts[cellIdx] = cellsData_[size_t(cellIdx) * 3 + 1];
+            field.oppAnts[cellIdx] = cellsData_[size_t(cellIdx) * 3 + 2];
+        }
+        field.finishTurnState();
+        return true;
+    }
+
+private:
+    const uint8_t* data_{ nullptr };
+    size_t size_{ 0 };
+    size_t pos_{ 0 };
+    bool isBuffered_{ false };
+    std::vector<char> buffer_;
+    TurnLogHeader header_{};
+    std::vector<int> cellsData_;
+
+    size_t initSize() const
+    {
+        return size_t(header_.cellsNb) * (1 + 7 * sizeof(int32_t)) + size_t(header_.basesNb) * 2 * sizeof(int32_t);
+    }
+
+    void readInts(int* values, int valuesNb)
+    {
+        std::memcpy(values, data_ + pos_, size_t(valuesNb) * sizeof(int32_t));
+        pos_ += size_t(valuesNb) * sizeof(int32_t);
+    }
+
+    uint32_t readVarint(size_t end)
+    {
+        uint32_t value = 0;
+        for (int shift = 0; pos_ < end && shift < 35; shift += 7)
+        {
+            const uint8_t byte = data_[pos_++];
+            value |= uint32_t(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+            {
+                break;
+            }
+        }
+        return value;
+    }
+};
+
+constexpr uint32_t TurnLogHeader::kMagic;
+constexpr uint32_t TurnLogHeader::kVersion;
+
+// per-phase turn timings: one line per turn and min/p50/p99/max table at the game end, both to stderr.
+// Build with -DSPRING_CHALLENGE_NO_PROFILER to remove all timers
+class TurnProfiler
+{
+public:
+    enum Phase
+    {
+        ReadTurnState,
+        BuildColonies,
+        MakeTurnEstimation,
+        SaveActualLines,
+        TryMakeNewLines,
+        SetBeacons,
+        PrintActions,
+        PhasesNb,
+    };
+
+    static constexpr int kReservedTurnsNb = 256;
+
+    TurnProfiler()
+    {
+        startTicks_ = readTicks();
+        startTime_ = std::chrono::steady_clock::now();
+        for (std::vector<uint64_t>& phaseSamples : samples_)
+        {
+            phaseSamples.reserve(kReservedTurnsNb);
+        }
+        turnSamples_.reserve(kReservedTurnsNb);
+    }
+
+    static uint64_t readTicks()
+    {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+        return __rdtsc();
+#else
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    void addPhaseTicks(Phase phase, uint64_t ticks)
+    {
+        turnPhaseTicks_[phase] += ticks;
+    }
+
+    void setInitTicks(uint64_t ticks)
+    {
+        initTicks_ = ticks;
+    }
+
+    void endTurn()
+    {
+        uint64_t turnTicks = 0;
+        for (int phase = 0; phase < PhasesNb; phase++)
+        {
+            samples_[phase].push_back(turnPhaseTicks_[phase]);
+            turnTicks += turnPhaseTicks_[phase];
+        }
+        turnSamples_.push_back(turnTicks);
+
+        std::fprintf(stderr, "Turn %d: %.3f ms |", int(turnSamples_.size()), toMs(turnTicks));
+        for (int phase = 0; phase < PhasesNb; phase++)
+        {
+            std::fprintf(stderr, " %s %.3f", kPhaseNames[phase], toMs(turnPhaseTicks_[phase]));
+            turnPhaseTicks_[phase] = 0;
+        }
+        std::fprintf(stderr, "\n");
+    }
+
+    void report()
+    {
+        std::fprintf(stderr, "Init (calcDistances): %.3f ms\n", toMs(initTicks_));
+        std::fprintf(stderr, "%-12s %9s %9s %9s %9s\n", "phase, ms", "min", "p50", "p99", "max");
+        for (int phase = 0; phase < PhasesNb; phase++)
+        {
+            reportSamples(kPhaseNames[phase], samples_[phase]);
+        }
+        reportSamples("turn", turnSamples_);
+    }
+
+private:
+    static constexpr const char* kPhaseNames[PhasesNb] = {
+        "read", "colonies", "estimation", "lines", "newLines", "beacons", "print"
+    };
+
+    uint64_t startTicks_;
+    std::chrono::steady_clock::time_point startTime_;
+    uint64_t initTicks_{ 0 };
+    std::array<uint64_t, PhasesNb> turnPhaseTicks_{};
+    std::array<std::vector<uint64_t>, PhasesNb> samples_;
+    std::vector<uint64_t> turnSamples_;
+
+    // ticks are calibrated against steady_clock over the whole time since start
+    double toMs(uint64_t ticks) const
+    {
+        const double elapsedNs = double(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime_).count());
+        const uint64_t elapsedTicks = readTicks() - startTicks_;
+        return elapsedTicks ? double(ticks) * elapsedNs / double(elapsedTicks) / 1e6 : 0.;
+    }
+
+    void reportSamples(const char* name, std::vector<uint64_t> phaseSamples) const
+    {
+        if (phaseSamples.empty())
+        {
+            return;
+        }
+        std::sort(phaseSamples.begin(), phaseSamples.end());
+        const size_t lastIdx = phaseSamples.size() - 1;
+        std::fprintf(stderr, "%-12s %9.3f %9.3f %9.3f %9.3f\n", name,
+                     toMs(phaseSamples.front()),
+                     toMs(phaseSamples[lastIdx / 2]),
+                     toMs(phaseSamples[lastIdx * 99 / 100]),
+                     toMs(phaseSamples.back()));
+    }
+};
+
+constexpr const char* TurnProfiler::kPhaseNames[TurnProfiler::PhasesNb];
+
+// adds lifetime of the scope to the phase
+class ScopedPhaseTimer
+{
+public:
+    ScopedPhaseTimer(TurnProfiler& profiler, TurnProfiler::Phase phase):
+        profiler_{ profiler }, phase_{ phase }, startTicks_{ TurnProfiler::readTicks() } {}
+
+    ~ScopedPhaseTimer()
+    {
+        profiler_.addPhaseTicks(phase_, TurnProfiler::readTicks() - startTicks_);
+    }
+
+private:
+    TurnProfiler& profiler_;
+    TurnProfiler::Phase phase_;
+    uint64_t startTicks_;
+};
+
+// pastes tokens after their expansion, so __LINE__ gives unique names to scoped objects
+#define SPRING_CHALLENGE_CONCAT_IMPL(lhs, rhs) lhs##rhs
+#define SPRING_CHALLENGE_CONCAT(lhs, rhs) SPRING_CHALLENGE_CONCAT_IMPL(lhs, rhs)
+
+#ifndef SPRING_CHALLENGE_NO_PROFILER
+#define PROFILE_PHASE(phase) ScopedPhaseTimer SPRING_CHALLENGE_CONCAT(phaseTimer, __LINE__)(profiler_, TurnProfiler::phase)
+#else
+#define PROFILE_PHASE(phase)
+#endif
+
+#ifdef SPRING_CHALLENGE_HEAP_STATS
+// counters of the global operator new/delete, which are replaced at the end of the file;
+// every block has a header with its size, so freed bytes and the live heap are known
+struct HeapCounters
+{
+    static std::atomic<uint64_t> allocationsNb;
+    static std::atomic<uint64_t> allocatedBytes;
+    static std::atomic<int64_t> liveBytes;
+    // max of liveBytes since the last resetPeak()
+    static std::atomic<int64_t> peakLiveBytes;
+
+    static void onAllocate(size_t size)
+    {
+        allocationsNb.fetch_add(1, std::memory_order_relaxed);
+        allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+        const int64_t live = liveBytes.fetch_add(int64_t(size), std::memory_order_relaxed) + int64_t(size);
+        int64_t peak = peakLiveBytes.load(std::memory_order_relaxed);
+        while (live > peak && !peakLiveBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    static void onFree(size_t size)
+    {
+        liveBytes.fetch_sub(int64_t(size), std::memory_order_relaxed);
+    }
+
+    static void resetPeak()
+    {
+        peakLiveBytes.store(liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+};
+
+std::atomic<uint64_t> HeapCounters::allocationsNb{ 0 };
+std::atomic<uint64_t> HeapCounters::allocatedBytes{ 0 };
+std::atomic<int64_t> HeapCounters::liveBytes{ 0 };
+std::atomic<int64_t> HeapCounters::peakLiveBytes{ 0 };
+
+// allocations, bytes and peak live heap of the turn phases: one line per turn and totals at the game end,
+// both to stderr. Built with -DSPRING_CHALLENGE_HEAP_STATS; counts all threads, so meant for the interactive loop
+class HeapStats
+{
+public:
+    enum Phase
+    {
+        ReadTurnState,
+        BuildColonies,
+        MakeTurnEstimation,
+        MakeActions,
+        PhasesNb,
+    };
+
+    struct PhaseUsage
+    {
+        uint64_t allocationsNb;
+        uint64_t bytes;
+        int64_t peakLiveBytes;
+    };
+
+    void addPhaseUsage(Phase phase, const PhaseUsage& usage)
+    {
+        PhaseUsage& turnUsage = turnUsages_[phase];
+        turnUsage.allocationsNb += usage.allocationsNb;
+        turnUsage.bytes += usage.bytes;
+        turnUsage.peakLiveBytes = std::max(turnUsage.peakLiveBytes, usage.peakLiveBytes);
+    }
+
+    // distance tables are the biggest part of the heap on large maps
+    void setInitFootprint(size_t distanceTablesBytes)
+    {
+        distanceTablesBytes_ = distanceTablesBytes;
+        initLiveBytes_ = HeapCounters::liveBytes.load(std::memory_order_relaxed);
+        std::fprintf(stderr, "Init heap: %lld B live, distance tables %zu B\n", static_cast<long long>(initLiveBytes_), distanceTablesBytes_);
+    }
+
+    void endTurn()
+    {
+        turnsNb_++;
+        int64_t turnPeakBytes = 0;
+        std::fprintf(stderr, "Turn %d heap |", turnsNb_);
+        for (int phase = 0; phase < PhasesNb; phase++)
+        {
+            PhaseUsage& turnUsage = turnUsages_[phase];
+            std::fprintf(stderr, " %s %llu/%lluB", kPhaseNames[phase],
+                static_cast<unsigned long long>(turnUsage.allocationsNb), static_cast<unsigned long long>(turnUsage.bytes));
+            turnPeakBytes = std::max(turnPeakBytes, turnUsage.peakLiveBytes);
+
+            PhaseUsage& totalUsage = totalUsages_[phase];
+            totalUsage.allocationsNb += turnUsage.allocationsNb;
+            totalUsage.bytes += turnUsage.bytes;
+            totalUsage.peakLiveBytes = std::max(totalUsage.peakLiveBytes, turnUsage.peakLiveBytes);
+            turnUsage = {};
+        }
+        std::fprintf(stderr, " | peak %lld B\n", static_cast<long long>(turnPeakBytes));
+    }
+
+    void report()
+    {
+        std::fprintf(stderr, "Init heap: %lld B live, distance tables %zu B\n", static_cast<long long>(initLiveBytes_), distanceTablesBytes_);
+        std::fprintf(stderr, "%-12s %12s %14s %14s\n", "phase", "allocs", "bytes", "peak live B");
+        for (int phase = 0; phase < PhasesNb; phase++)
+        {
+            const PhaseUsage& totalUsage = totalUsages_[phase];
+            std::fprintf(stderr, "%-12s %12llu %14llu %14lld\n", kPhaseNames[phase],
+                static_cast<unsigned long long>(totalUsage.allocationsNb), static_cast<unsigned long long>(totalUsage.bytes),
+                static_cast<long long>(totalUsage.peakLiveBytes));
+        }
+    }
+
+private:
+    static constexpr const char* kPhaseNames[PhasesNb] = {
+        "read", "colonies", "estimation", "actions"
+    };
+
+    int turnsNb_{ 0 };
+    size_t distanceTablesBytes_{ 0 };
+    int64_t initLiveBytes_{ 0 };
+    std::array<PhaseUsage, PhasesNb> turnUsages_{};
+    std::array<PhaseUsage, PhasesNb> totalUsages_{};
+};
+
+constexpr const char* HeapStats::kPhaseNames[HeapStats::PhasesNb];
+
+// adds heap usage of the scope to the phase
+class ScopedHeapPhase
+{
+public:
+    ScopedHeapPhase(HeapStats& stats, HeapStats::Phase phase):
+        stats_{ stats }, phase_{ phase },
+        startAllocationsNb_{ HeapCounters::allocationsNb.load(std::memory_order_relaxed) },
+        startBytes_{ HeapCounters::allocatedBytes.load(std::memory_order_relaxed) }
+    {
+        HeapCounters::resetPeak();
+    }
+
+    ~ScopedHeapPhase()
+    {
+        stats_.addPhaseUsage(phase_, {
+            HeapCounters::allocationsNb.load(std::memory_order_relaxed) - startAllocationsNb_,
+            HeapCounters::allocatedBytes.load(std::memory_order_relaxed) - startBytes_,
+            HeapCounters::peakLiveBytes.load(std::memory_order_relaxed) });
+    }
+
+private:
+    HeapStats& stats_;
+    HeapStats::Phase phase_;
+    uint64_t startAllocationsNb_;
+    uint64_t startBytes_;
+};
+
+#define HEAP_PHASE(phase) ScopedHeapPhase SPRING_CHALLENGE_CONCAT(heapPhase, __LINE__)(heapStats_, HeapStats::phase)
+#else
+#define HEAP_PHASE(phase)
+#endif
+
+struct Beacon
+{
+    int cell;
+    int strength;
+};
+
+// time limit of the turn which the referee gives
+constexpr double kTurnTimeLimitMs = 100.;
+// part of the turn limit which the bot doesn't see: the deadline is counted from the first byte of input,
+// but the referee's clock starts earlier and stops only when the output has reached it; the reserve
+// also covers the scheduling delays of a shared server and the output itself
+constexpr double kTurnTimeReserveMs = 20.;
+
+// strategy tunables, defaults are the values played online
+struct GameParams
+{
+    // new lines are built to candidates not worse than this part of the best free candidate
+    double newLinesThresholdRatio{ 0.6 };
+    // beacon strength on cells where opponent has more ants and on other cells
+    int contestedBeaconStrength{ 8 };
+    int beaconStrength{ 4 };
+    // time of the turn from the first byte of its input; 0 - no deadline
+    double turnTimeBudgetMs{ kTurnTimeLimitMs - kTurnTimeReserveMs };
+};
+
+// bot over the field with the given capacities
+template <int MaxCells, int MaxBases>
+class BasicGame
+{
+    // microbenchmarks call single phases of the turn
+    friend struct GamePhases;
+
+    using FieldType = BasicField<MaxCells, MaxBases>;
+
+    InputReader input_;
+    FieldType field_;
+    CommandEmitter output_;
+    GameParams params_;
+
+    // beacons placed on current turn, ordered by cell
+    std::vector<Beacon> turnBeacons_;
+
+    // binary copy of all input, when recording is on
+    std::unique_ptr<TurnLogWriter> recorder_;
+
+    // distances to the beacons of colony which is processed in tryMakeNewLinesInColonies
+    DistanceField beaconsDistField_;
+
+    // distances to the lines of colony which is processed in buildColonyLines
+    DistanceField linesDistField_;
+
+    // beacons of all colonies on current turn
+    CellSet totalBeaconsSet_;
+
+    // end of the time budget of current turn; turns which aren't read from input
+    // (replay, simulator) have no deadline, so they are computed in full
+    bool hasTurnDeadline_{ false };
+    std::chrono::steady_clock::time_point turnDeadline_;
+
+#ifndef SPRING_CHALLENGE_NO_PROFILER
+    TurnProfiler profiler_;
+#endif
+#ifdef SPRING_CHALLENGE_HEAP_STATS
+    HeapStats heapStats_;
+#endif
+
+private:
+    // returns false when input is over
+    bool readTurnState()
+    {
+        // waiting for the referee isn't a part of the turn
+        if (!input_.waitInput())
+        {
+            return false;
+        }
+        hasTurnDeadline_ = params_.turnTimeBudgetMs > 0.;
+        turnDeadline_ = std::chrono::steady_clock::now()
+            + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(params_.turnTimeBudgetMs));
+
+        {
+            PROFILE_PHASE(ReadTurnState);
+            HEAP_PHASE(ReadTurnState);
+            field_.readTurnState(input_);
+        }
+        if (input_.isTruncated)
+        {
+            return false;
+        }
+
+        if (recorder_)
+        {
+            recorder_->writeTurn(field_);
+        }
+        return true;
+    }
+
+    void finishInit()
+    {
+        turnBeacons_.reserve(field_.numberOfCells);
+
+#ifndef SPRING_CHALLENGE_NO_PROFILER
+        const uint64_t initStartTicks = TurnProfiler::readTicks();
+#endif
+        field_.calcDistances();
+#ifndef SPRING_CHALLENGE_NO_PROFILER
+        profiler_.setInitTicks(TurnProfiler::readTicks() - initStartTicks);
+#endif
+#ifdef SPRING_CHALLENGE_HEAP_STATS
+        heapStats_.setInitFootprint(field_.distances.capacity() * sizeof(uint16_t) + field_.nextDirs.capacity() * sizeof(uint8_t));
+#endif
+    }
+
+    // turn has at least reserve time before the deadline
+    bool isTurnTimeLeft(std::chrono::steady_clock::duration reserve = std::chrono::steady_clock::duration::zero()) const
+    {
+        return !hasTurnDeadline_ || std::chrono::steady_clock::now() + reserve < turnDeadline_;
+    }
+
+    void endTurn()
+    {
+#ifndef SPRING_CHALLENGE_NO_PROFILER
+        profiler_.endTurn();
+#endif
+#ifdef SPRING_CHALLENGE_HEAP_STATS
+        heapStats_.endTurn();
+#endif
+    }
+
+    void reportStats()
+    {
+#ifndef SPRING_CHALLENGE_NO_PROFILER
+        profiler_.report();
+#endif
+#ifdef SPRING_CHALLENGE_HEAP_STATS
+        heapStats_.report();
+#endif
+    }
+
+    void printActions()
+    {
+        for (const Beacon& beacon : turnBeacons_)
+        {
+            output_.beacon(beacon.cell, beacon.strength);
+        }
+
+        // empty actions case is handled by emitter
+        output_.flush();
+    }
+
+    // lines of the colony between its base and resource cells, lineCells gets all cells of the lines
+    void buildColonyLines(const CellSet& colonyCells, ArenaMap<int, int>& lines, CellSet& lineCells)
+    {
+        lines.clear();
+        lineCells.clear();
+
+    //      
+        int friendlyColonyBase = -1;
+        for (int friendlyBase : field_.friendlyBases)
+        {
+            if (colonyCells.count(friendlyBase))
             {
-                const std::map<int, std::vector<int>>& pathMapFromCrystalCell = pathMapVec.at(crystalCell);
+                friendlyColonyBase = friendlyBase;
+                break;
+            }
+        }
+
+        // std::cerr << "friendly base in colony " << colonyId << ": " << friendlyColonyBase << std::endl;
+
+        //     ,   ,              
+        if (friendlyColonyBase == -1)
+        {
+            // std::cerr << "FIXME saveActualLinesInColonies" << std::endl;
+            return;
+        }
 
-                // find nearest friendly cell IN THIS COLONY to this crystal cell
-                int distFromNearestColonyCell = maxFieldDist;
+        //    
+        //        ,  - 
+        CellSet colonyReferenceCells(field_.numberOfCells, &field_.turnArena);
+        colonyReferenceCells.insert(friendlyColonyBase);
+
+        //      
+        //   freeReferenceCells,   
+        CellSet freeReferenceCells(field_.numberOfCells, &field_.turnArena);
+        freeReferenceCells |= field_.eggsCells;
+        freeReferenceCells |= field_.crystalCells;
+        freeReferenceCells &= colonyCells;
+
+        //  ,    
+        CellSet allCellsUsedInLines(field_.numberOfCells, &field_.turnArena);
+
+    //        :    (   )
+    //       ;     BFS    ,
+    //          
+        allCellsUsedInLines.insert(friendlyColonyBase);
+        linesDistField_.reset(field_.numberOfCells);
+        linesDistField_.addSource(friendlyColonyBase);
+
+        while (!freeReferenceCells.empty())
+        {
+            linesDistField_.propagate(field_.neighs);
 
-                const std::set<int>& friendlyCellsInColonySet = colonyWorthMapPair.second;
-                for (int friendlyColonyCell : friendlyCellsInColonySet)
+            int nextUsedReferenceCell = -1;
+            int minDistFromRefernceCell = DistanceField::kUnreachableDist;
+            for (int colonyCell : freeReferenceCells)
+            {
+                const int curDist = linesDistField_.dists[colonyCell];
+                if (curDist < minDistFromRefernceCell)
                 {
-                    const std::vector<int>& shortestPathListFromCrystalToThisCell = pathMapFromCrystalCell.at(friendlyColonyCell);
-                    if (shortestPathListFromCrystalToThisCell.size() < distFromNearestColonyCell)
+                    minDistFromRefernceCell = curDist;
+                    nextUsedReferenceCell = colonyCell;
+
+                    //      ,       
+                    if (minDistFromRefernceCell <= 1)
                     {
-                        distFromNearestColonyCell = int(shortestPathListFromCrystalToThisCell.size());
+                        break;
                     }
                 }
+            }
 
-                float distCoef = distFromNearestColonyCell == 0 ? 0.5f : (1 / float(distFromNearestColonyCell));
-                curColonyWorthMap[crystalCell] = float(cells.at(crystalCell).curResources * crystallEstimation) * distCoef;
+            //      
+            if (nextUsedReferenceCell == -1)
+            {
+                break;
             }
 
-    //                 
-            //     curColonyWorthMap     
-            for (const auto& worthPair : curColonyWorthMap)
+            //   
+            const int nearestCellInAllCellsUsedInLines = linesDistField_.nearestSources[nextUsedReferenceCell];
+            lines[nextUsedReferenceCell] = nearestCellInAllCellsUsedInLines;
+
+            //    -      ,  ,    ,
+            //       
+            for (int pathCell : field_.path(nearestCellInAllCellsUsedInLines, nextUsedReferenceCell))
+            {
+                allCellsUsedInLines.insert(pathCell);
+                linesDistField_.addSource(pathCell);
+                if (freeReferenceCells.count(pathCell))
+                {
+                    freeReferenceCells.erase(pathCell);
+                    colonyReferenceCells.insert(pathCell);
+                }
+            }
+        }
+
+        lineCells = allCellsUsedInLines;
+    }
+
+    void saveActualLinesInColonies()
+    {
+        // std::cerr << "begin saveActualLinesInColonies" << std::endl;
+
+        //         -   ,   - 
+        //         
+        //  ,     ,    /   
+
+        // lines of the previous turn are kept while the colony and its resource cells are the same
+        for (const auto& colonyPair : field_.turnColoniesMap)
+        {
+            const int colonyId = colonyPair.first;
+            const CellSet& colonyCells = colonyPair.second;
+
+            const bool areLinesActual = field_.areColonyLinesActual(colonyId, colonyCells);
+            CellSet& lineCells = field_.colonyLinesCells(colonyId);
+            if (!areLinesActual)
+            {
+                buildColonyLines(colonyCells, field_.colonyLines(colonyId), lineCells);
+            }
+#ifdef SPRING_CHALLENGE_CHECK_INCREMENTAL
+            else
+            {
+                ArenaMap<int, int> lines{ ArenaAllocator<std::pair<const int, int>>(&field_.turnArena) };
+                CellSet builtLineCells(field_.numberOfCells, &field_.turnArena);
+                buildColonyLines(colonyCells, lines, builtLineCells);
+                const ArenaMap<int, int>& keptLines = field_.colonyLines(colonyId);
+                FieldType::checkIncremental(lines.size() == keptLines.size() && std::equal(lines.begin(), lines.end(), keptLines.begin()), "colony lines");
+                FieldType::checkIncremental(builtLineCells.words == lineCells.words, "colony line cells");
+            }
+#endif
+
+        //          
+            field_.colonyBeacons(colonyId) = lineCells;
+        }
+
+        // std::cerr << "end saveActualLinesInColonies" << std::endl;
+    }
+
+    void addColonyBeacon(int colonyId, int cell)
+    {
+        field_.colonyBeacons(colonyId).insert(cell);
+        beaconsDistField_.addSource(cell);
+    }
+
+    // plan is complete after every new line, so lines are added while the next one surely fits
+    // the turn deadline: the longest line of the turn is taken as the time of the next one
+    void tryMakeNewLinesInColonies()
+    {
+        // std::cerr << "begin tryMakeNewLinesInColonies" << std::endl;
+
+        std::chrono::steady_clock::duration maxLineDuration = std::chrono::steady_clock::duration::zero();
+        std::chrono::steady_clock::time_point lineStartTime = std::chrono::steady_clock::now();
+
+        //     " ":      , ,   
+        for (const auto& colonyPair : field_.turnColoniesMap)
+        {
+            const int colonyId = colonyPair.first;
+            const CellSet& curColonyCellSet = colonyPair.second;
+            
+            CandidateList& colonyCandidates = field_.colonyCandidates(colonyId);
+            const CellSet& colonyBeaconsSet = field_.colonyBeacons(colonyId);
+            auto isBeaconCell = [&colonyBeaconsSet](int cell) { return colonyBeaconsSet.count(cell) != 0; };
+
+            //      -  
+            if (colonyCandidates.empty())
+            {
+                continue;
+            }
+
+            //      ,     
+            //     ,         
+            float colonyEstimationThreshold = -1.f;
+            if (const ScoredCell* bestCandidate = colonyCandidates.bestFree(isBeaconCell))
+            {
+                colonyEstimationThreshold = bestCandidate->score * params_.newLinesThresholdRatio;
+            }
+
+            if (field_.isDebugLogEnabled)
+            {
+                std::cerr << "Estimation threshold for colony " << colonyId << ": " << colonyEstimationThreshold << std::endl;
+            }
+
+            // distances to nearest beacon are kept up to date while beacons are added
+            beaconsDistField_.reset(field_.numberOfCells);
+            for (int beaconCell : colonyBeaconsSet)
+            {
+                beaconsDistField_.addSource(beaconCell);
+            }
+
+            bool existCellWithHighEstimate = true;
+            while (existCellWithHighEstimate)
             {
-                float curCellFullWorth = worthPair.second;
-                //   
-                for (int neight : cells[worthPair.first].neighArr)
+                if (hasTurnDeadline_)
+                {
+                    const std::chrono::steady_clock::time_point curTime = std::chrono::steady_clock::now();
+                    maxLineDuration = std::max(maxLineDuration, curTime - lineStartTime);
+                    lineStartTime = curTime;
+                    if (!isTurnTimeLeft(maxLineDuration))
+                    {
+                        if (field_.isDebugLogEnabled)
+                        {
+                            std::cerr << "Turn deadline: new lines planning is stopped in colony " << colonyId << std::endl;
+                        }
+                        return;
+                    }
+                }
+
+                existCellWithHighEstimate = false;
+
+                float curEstimation = -1.f;
+
+                // find cell with max estimate for that not yet exist in field_.coloniesBeaconsSetMap[colonyId]
+                int cellWithMaxEstimate = -1;
+                const ScoredCell* bestCandidate = colonyCandidates.bestFree(isBeaconCell);
+                if (bestCandidate && bestCandidate->score >= colonyEstimationThreshold)
+                {
+                    cellWithMaxEstimate = bestCandidate->cell;
+                    curEstimation = bestCandidate->score;
+                }
+
+                // if cellWithMaxEstimate not found - continue
+                if (cellWithMaxEstimate == -1)
+                {
+                    break;
+                }
+
+                if (field_.isDebugLogEnabled)
+                {
+                    std::cerr << "Next cell with high estimation for colony " << colonyId << ": " << cellWithMaxEstimate << ", estimation " << curEstimation << std::endl;
+                }
+
+                existCellWithHighEstimate = true;
+
+                //      ,      
+                //     field_.coloniesBeaconsSetMap[colonyId]
+
+                beaconsDistField_.propagate(field_.neighs);
+                const int distToCellWithMaxEstimate = beaconsDistField_.dists[cellWithMaxEstimate];
+                const int nearestColonyCellToBestCell = beaconsDistField_.nearestSources[cellWithMaxEstimate];
+
+                // std::cerr << "\tdistToCellWithMaxEstimate: " << distToCellWithMaxEstimate << std::endl;
+                // std::cerr << "\tnearestColonyCellToBestCell: " << nearestColonyCellToBestCell << std::endl;
+
+                // make beacons path without intermediate cells
+                if (distToCellWithMaxEstimate < 2)
+                {
+                    addColonyBeacon(colonyId, cellWithMaxEstimate);
+                    continue;
+                }
+
+                // if dist >= 2 its possible to make OPTIMAL path over other usefull cells
+
+                int maxPossiblePathLength = distToCellWithMaxEstimate + distToCellWithMaxEstimate / 2 + 1;
+                // path over the cell is twice its distance from the best cell
+                const int maxDistFromBestCell = std::min(distToCellWithMaxEstimate, maxPossiblePathLength / 2);
+
+                // find all usefull cells in radius (distToCellWithMaxEstimate) without cell (cellWithMaxEstimate)
+                // and take the best of them: max radius worth, then max cell worth, then max cell;
+                // other cells are at least at distance 1 from the best cell, so radius worth of a cell is at most
+                // the half of its worth and the scan from the best worths stops when that bound is below the found one
+                ScoredCell bestRadiusCell{ 0.f, -1 };
+                float bestRadiusCellWorth = 0.f;
+                for (const ScoredCell& candidate : colonyCandidates.rankedItems())
                 {
-                    if (neight == -1)
+                    const int curWorthCell = candidate.cell;
+
+                    if (bestRadiusCell.cell != -1 && std::max(candidate.score * 0.5f, 0.f) < bestRadiusCellWorth)
+                    {
+                        break;
+                    }
+
+                    // skip cell with max estimate
+                    if (curWorthCell == cellWithMaxEstimate)
+                    {
+                        continue;
+                    }
+
+                    // skip cell with too long dist
+                    const int distFromBestCell = field_.dist(cellWithMaxEstimate, curWorthCell);
+                    if (distFromBestCell > maxDistFromBestCell
+                        || field_.dist(nearestColonyCellToBestCell, curWorthCell) > distToCellWithMaxEstimate)
                     {
                         continue;
                     }
-                    if (curColonyWorthMap.count(neight))
+                    int pathOverCellLength = distFromBestCell + distFromBestCell;
+
+                    float distCoef = pathOverCellLength == 0 ? 2 : (1 / float(pathOverCellLength));
+                    const float radiusCellWorth = candidate.score * distCoef;
+                    if (bestRadiusCell.cell == -1
+                        || radiusCellWorth > bestRadiusCellWorth
+                        || (radiusCellWorth == bestRadiusCellWorth
+                            && (candidate.score > bestRadiusCell.score || (candidate.score == bestRadiusCell.score && candidate.cell > bestRadiusCell.cell))))
                     {
-                        curCellFullWorth += curColonyWorthMap[neight] * 0.8;
+                        bestRadiusCell = candidate;
+                        bestRadiusCellWorth = radiusCellWorth;
                     }
                 }
 
-                //     
-                worthToCellSetColonyMap[colonyId][curCellFullWorth].insert(worthPair.first);
-            }
-
-    // print estimation
-            std::cerr << "Estimation for colony " + std::to_string(colonyId) + ": ";
-            for (auto estimationCellRIter = worthToCellSetColonyMap[colonyId].rbegin(); 
-                estimationCellRIter != worthToCellSetColonyMap[colonyId].rend();
-                estimationCellRIter++)
-            {
-                std::cerr << estimationCellRIter->first << " (";
-                for (int cell : estimationCellRIter->second)
+                // if no more useful cells in radius make direct line to nearest colony cell
+                if (bestRadiusCell.cell == -1)
                 {
-                    std::cerr << cell;
-                    if (cell != *std::prev(estimationCellRIter->second.end()))
+                    //  allCellsUsedInLines
+                    for (int cell : field_.path(nearestColonyCellToBestCell, cellWithMaxEstimate))
                     {
-                        std::cerr << ", ";
+                        addColonyBeacon(colonyId, cell);
                     }
+                    continue;
+                }
+
+                // take max useful cell and make path over this cell with beacons
+
+                int intermdiateCell = bestRadiusCell.cell;
+                if (field_.isDebugLogEnabled)
+                {
+                    std::cerr << "Intermdiate Cell for colony " << colonyId << " with max esimation : " << intermdiateCell << std::endl;
+                }
+
+                // make line from nearest colony cell to Intermdiate Cell
+                for (int cell : field_.path(nearestColonyCellToBestCell, intermdiateCell))
+                {
+                    addColonyBeacon(colonyId, cell);
+                }
+                // and then make line from Intermdiate Cell to Cell with max estimate
+                for (int cell : field_.path(intermdiateCell, cellWithMaxEstimate))
+                {
+                    addColonyBeacon(colonyId, cell);
                 }
-                std::cerr << "), ";
             }
-            std::cerr << std::endl;
         }
+
+        // std::cerr << "end tryMakeNewLinesInColonies" << std::endl;
     }
-};
 
-class Game
-{
-    Field field_;
-    std::vector<std::unique_ptr<Action>> curTurnActions;
+    void setBeacons()
+    {
+        totalBeaconsSet_.resize(field_.numberOfCells);
+        for (const auto& colonyPair : field_.turnColoniesMap)
+        {
+            const int colonyId = colonyPair.first;
+            totalBeaconsSet_ |= field_.colonyBeacons(colonyId);
+        }
+        turnBeacons_.clear();
+        for (int beaconCell : totalBeaconsSet_)
+        {
+            const int strength = field_.oppAnts[beaconCell] > field_.myAnts[beaconCell] ? params_.contestedBeaconStrength : params_.beaconStrength;
+            turnBeacons_.push_back({ beaconCell, strength });
+        }
+    }
 
-private:
-    void readTurnState()
+    void makeActions()
+    {
+
+        {
+            PROFILE_PHASE(SaveActualLines);
+            saveActualLinesInColonies();
+        }
+
+        // even the plan of the kept lines is late: beacons of the previous turn are repeated
+        if (!isTurnTimeLeft())
+        {
+            if (field_.isDebugLogEnabled)
+            {
+                std::cerr << "Turn deadline is missed, previous beacons are repeated" << std::endl;
+            }
+            PROFILE_PHASE(PrintActions);
+            printActions();
+            return;
+        }
+
+        {
+            PROFILE_PHASE(TryMakeNewLines);
+            tryMakeNewLinesInColonies();
+        }
+        {
+            PROFILE_PHASE(SetBeacons);
+            setBeacons();
+        }
+        {
+            PROFILE_PHASE(PrintActions);
+            printActions();
+        }
+    }
+
+public:
+    // negative output descriptor discards printed actions
+    BasicGame(int inputFd = 0, int outputFd = 1):
+        input_{ inputFd }, output_{ outputFd } {}
+
+    // continues the input which is already partly read, e.g. the cells number
+    BasicGame(const InputReader& input, int outputFd = 1):
+        input_{ input }, output_{ outputFd } {}
+
+    FieldType& field() { return field_; }
+    const FieldType& field() const { return field_; }
+    const std::vector<Beacon>& turnBeacons() const { return turnBeacons_; }
+    const GameParams& params() const { return params_; }
+    void setParams(const GameParams& params) { params_ = params; }
+
+    // init from the map of in-process simulator instead of input
+    void init(const FieldType& mapField, bool isSecondPlayer)
     {
-        field_.readTurnState();
-        field_.buildColonies();
-        field_.makeTurnEstimation();
+        field_.init(mapField, isSecondPlayer);
+        if (field_.distances.empty())
+        {
+            field_.calcDistances();
+        }
+        turnBeacons_.reserve(field_.numberOfCells);
     }
 
-    void printActions()
+    // colonies, estimations and actions for the turn state which is already in field()
+    void processTurn()
     {
-        // empty actions case
-        if (curTurnActions.empty())
         {
-            curTurnActions.push_back(std::make_unique<Action>());
+            PROFILE_PHASE(BuildColonies);
+            HEAP_PHASE(BuildColonies);
+            field_.buildColonies();
+        }
+        {
+            PROFILE_PHASE(MakeTurnEstimation);
+            HEAP_PHASE(MakeTurnEstimation);
+            field_.makeTurnEstimation();
+        }
+        {
+            HEAP_PHASE(MakeActions);
+            makeActions();
         }
+    }
 
-        // print actions
-        for (std::unique_ptr<Action>& actionPtr : curTurnActions)
+    // input is recorded to the file from init() on
+    bool record(const char* path)
+    {
+        recorder_.reset(new TurnLogWriter());
+        if (!recorder_->open(path))
         {
-            cout << actionPtr->stringify();
+            recorder_.reset();
+            return false;
         }
-        cout << endl;
+        return true;
     }
 
-    void saveActualLinesInColonies()
+    bool init()
     {
-        // std::cerr << "begin saveActualLinesInColonies" << std::endl;
+        return init(input_.readInt());
+    }
 
-        //         -   ,   - 
-        //         
-        //  ,     ,    /   
+    // map input after the cells number, false when the map is invalid or too big for the field
+    bool init(int cellsNb)
+    {
+        if (!field_.init(cellsNb, input_))
+        {
+            return false;
+        }
+        if (recorder_)
+        {
+            recorder_->writeInit(field_);
+        }
+        finishInit();
+        return true;
+    }
 
-        for (const auto& colonyPair : field_.turnColoniesMap)
+    // whole recorded game instead of init() and start(), false when the log can't be read
+    bool replay(const char* path)
+    {
+        TurnLogReader reader;
+        if (!reader.open(path))
         {
-            const int colonyId = colonyPair.first;
-            const std::set<int> colonyCells = colonyPair.second;
+            return false;
+        }
+        return replay(reader);
+    }
+
+    // whole game from the opened log, false when its map is invalid or too big for the field
+    bool replay(TurnLogReader& reader)
+    {
+        if (!reader.initField(field_))
+        {
+            return false;
+        }
+        finishInit();
 
-        //      
-            int friendlyColonyBase = -1;
-            for (int friendlyBase : field_.friendlyBases)
+        while (true)
+        {
             {
-                if (colonyCells.count(friendlyBase))
+                PROFILE_PHASE(ReadTurnState);
+                HEAP_PHASE(ReadTurnState);
+                if (!reader.readTurn(field_))
                 {
-                    friendlyColonyBase = friendlyBase;
                     break;
                 }
             }
+            processTurn();
+            endTurn();
+        }
+        reportStats();
+        return true;
+    }
+
+    void start()
+    {
+        while (readTurnState())
+        {
+            processTurn();
+            endTurn();
+        }
+        reportStats();
+    }
+};
 
-            // std::cerr << "friendly base in colony " << colonyId << ": " << friendlyColonyBase << std::endl;
+using Game = BasicGame<kDynamicCapacity, kDynamicCapacity>;
 
-            //     ,   ,              
-            if (friendlyColonyBase == -1)
-            {
-                // std::cerr << "FIXME saveActualLinesInColonies" << std::endl;
-                continue;
-            }
+template <class T>
+struct TypeTag
+{
+    using Type = T;
+};
 
-            //    
-            //        ,  - 
-            std::set<int> colonyReferenceCells{ friendlyColonyBase };
+// calls func with TypeTag of the smallest game instantiation which fits the map of cellsNb cells
+// and basesNb bases of every player, other maps are played by Game with dynamic storage;
+// when the bases number isn't read yet, cellsNb / 2 is its bound for any valid map
+template <class Func>
+int withGameCapacity(int cellsNb, int basesNb, Func&& func)
+{
+    if (BasicField<128, 64>::fitsMap(cellsNb, basesNb))
+    {
+        return func(TypeTag<BasicGame<128, 64>>());
+    }
+    if (BasicField<512, 256>::fitsMap(cellsNb, basesNb))
+    {
+        return func(TypeTag<BasicGame<512, 256>>());
+    }
+    return func(TypeTag<Game>());
+}
 
-            //      
-            std::set<int> freeReferenceCells;
+// every worker owns a deque with a contiguous block of task indices: it takes tasks from the back
+// of its own deque and steals from the front of others when it runs out, so long games
+// on big maps don't leave the rest of the threads idle
+class WorkStealingPool
+{
+public:
+    explicit WorkStealingPool(int threadsNb = 0):
+        threadsNb_{ threadsNb > 0 ? threadsNb : int(std::max(1u, std::thread::hardware_concurrency())) } {}
 
-            //  ,    
-            std::set<int> allCellsUsedInLines;
+    int threadsNb() const { return threadsNb_; }
 
-            //   freeReferenceCells
-            for (int colonyCell : colonyCells)
+    // calls func(taskIdx, workerIdx) for every task in [0, tasksNb), returns when all are done
+    template <typename Func>
+    void run(int tasksNb, Func func)
+    {
+        std::vector<WorkerQueue> queues(threadsNb_);
+        for (int workerIdx = 0; workerIdx < threadsNb_; workerIdx++)
+        {
+            const int firstTask = int(int64_t(tasksNb) * workerIdx / threadsNb_);
+            const int lastTask = int(int64_t(tasksNb) * (workerIdx + 1) / threadsNb_);
+            for (int taskIdx = firstTask; taskIdx < lastTask; taskIdx++)
             {
-                //   
-                if (!field_.eggsCells.count(colonyCell) && !field_.crystalCells.count(colonyCell))
-                {
-                    continue;
-                }
-
-                freeReferenceCells.insert(colonyCell);
+                queues[workerIdx].tasks.push_back(taskIdx);
             }
+        }
 
-        //      ,          freeReferenceCells
-            int nearestResourceColonyCellToFriendBase = -1;
-            int minDist = field_.maxFieldDist;
-            for (int colonyCell : freeReferenceCells)
+        auto work = [&queues, &func, this](int workerIdx)
+        {
+            int taskIdx;
+            while (takeTask(queues, workerIdx, taskIdx))
             {
-                int curDist = field_.pathMapVec[colonyCell][friendlyColonyBase].size();
-                if (curDist < minDist)
-                {
-                    minDist = curDist;
-                    nearestResourceColonyCellToFriendBase = colonyCell;
-                }
+                func(taskIdx, workerIdx);
             }
+        };
 
-            // std::cerr << "Nearest Colony Cell with resources To Friendly Base base in colony " << colonyId << ": " << nearestResourceColonyCellToFriendBase << std::endl;
-
-            if (nearestResourceColonyCellToFriendBase == -1)
-            {
-                field_.coloniesBeaconsSetMap[colonyId] = { friendlyColonyBase };
-                continue;
-            }
+        std::vector<std::thread> threads;
+        threads.reserve(threadsNb_ - 1);
+        for (int workerIdx = 1; workerIdx < threadsNb_; workerIdx++)
+        {
+            threads.emplace_back(work, workerIdx);
+        }
+        work(0);
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+    }
 
-            //    
-            field_.coloniesLinesMap[colonyId][friendlyColonyBase] = nearestResourceColonyCellToFriendBase;
+private:
+    struct WorkerQueue
+    {
+        std::mutex mutex;
+        std::deque<int> tasks;
+    };
 
-            //   
-            freeReferenceCells.erase(nearestResourceColonyCellToFriendBase);
-            colonyReferenceCells.insert(nearestResourceColonyCellToFriendBase);
+    int threadsNb_;
 
-            //  allCellsUsedInLines
-            allCellsUsedInLines.insert(friendlyColonyBase);
-            for (int cell : field_.pathMapVec[friendlyColonyBase][nearestResourceColonyCellToFriendBase])
+    // tasks don't create new tasks, so all queues being empty means the work is over
+    bool takeTask(std::vector<WorkerQueue>& queues, int workerIdx, int& taskIdx)
+    {
+        {
+            WorkerQueue& own = queues[workerIdx];
+            std::lock_guard<std::mutex> lock{ own.mutex };
+            if (!own.tasks.empty())
             {
-                allCellsUsedInLines.insert(cell);
+                taskIdx = own.tasks.back();
+                own.tasks.pop_back();
+                return true;
             }
+        }
 
-        //     
-        //     ,        
-            while (freeReferenceCells.size())
+        for (int shift = 1; shift < threadsNb_; shift++)
+        {
+            WorkerQueue& victim = queues[(workerIdx + shift) % threadsNb_];
+            std::lock_guard<std::mutex> lock{ victim.mutex };
+            if (!victim.tasks.empty())
             {
-                int nextUsedReferenceCell = -1;
-                int nearestCellInAllCellsUsedInLines = -1;
-                int minDistFromRefernceCell = field_.maxFieldDist;
-
-                for (int colonyCell : freeReferenceCells)
-                {
-                    for (int linesCell : allCellsUsedInLines)
-                    {
-                        int curDist = field_.pathMapVec[colonyCell][linesCell].size();
-                        if (curDist < minDistFromRefernceCell)
-                        {
-                            minDist = curDist;
-                            nextUsedReferenceCell = colonyCell;
-                            nearestCellInAllCellsUsedInLines = linesCell;
-                        }
-
-                        //  
-                        if (minDistFromRefernceCell <= 1)
-                        {
-                            break;
-                        }
-                    }
-
-                    //  
-                    if (minDistFromRefernceCell <= 1)
-                    {
-                        break;
-                    }
-                }
-
-                //      
-                if (nextUsedReferenceCell == -1 || nearestCellInAllCellsUsedInLines == -1)
-                {
-                    break;
-                }
-
-
-             //   
-                field_.coloniesLinesMap[colonyId][nextUsedReferenceCell] = nearestCellInAllCellsUsedInLines;
-
-                //   
-                freeReferenceCells.erase(nextUsedReferenceCell);
-                colonyReferenceCells.insert(nextUsedReferenceCell);
-
-                //  allCellsUsedInLines
-                for (int cell : field_.pathMapVec[nearestCellInAllCellsUsedInLines][nextUsedReferenceCell])
-                {
-                    allCellsUsedInLines.insert(cell);
-                }
+                taskIdx = victim.tasks.front();
+                victim.tasks.pop_front();
+                return true;
             }
-
-        //          
-            field_.coloniesBeaconsSetMap[colonyId] = allCellsUsedInLines;
         }
-
-        // std::cerr << "end saveActualLinesInColonies" << std::endl;
+        return false;
     }
+};
 
-    void tryMakeNewLinesInColonies()
+#if defined(__unix__) || defined(__APPLE__)
+// offline regression run over a directory of turn logs: every turn of every game is computed
+// from its snapshot alone, so turns of all games are spread over all cores;
+// results file gets "<log> <turn> <processTurn ns> <actions>" line for every turn
+class BatchRunner
+{
+public:
+    explicit BatchRunner(int threadsNb = 0):
+        pool_{ threadsNb } {}
+
+    bool run(const char* logsDir, const char* resultsPath)
     {
-        // std::cerr << "begin tryMakeNewLinesInColonies" << std::endl;
+        std::vector<std::string> logPaths;
+        if (!listLogs(logsDir, logPaths))
+        {
+            std::cerr << "Can't read directory " << logsDir << std::endl;
+            return false;
+        }
+        FILE* results = std::fopen(resultsPath, "w");
+        if (!results)
+        {
+            std::cerr << "Can't open " << resultsPath << std::endl;
+            return false;
+        }
 
-        //     " ":      , ,   
-        for (const auto& colonyPair : field_.turnColoniesMap)
+        int gamesNb = 0;
+        long long turnsNb = 0;
+        const auto startTime = std::chrono::steady_clock::now();
+        // logs are loaded by chunks, so memory doesn't grow with the corpus size
+        for (size_t firstLog = 0; firstLog < logPaths.size(); firstLog += kChunkGamesNb)
         {
-            const int colonyId = colonyPair.first;
-            const std::set<int>& curColonyCellSet = colonyPair.second;
-            
-            //      -  
-            if (field_.worthToCellSetColonyMap[colonyId].empty())
+            const size_t chunkGamesNb = std::min(logPaths.size() - firstLog, size_t(kChunkGamesNb));
+            std::vector<GameLog> games(chunkGamesNb);
+            pool_.run(int(chunkGamesNb), [&](int gameIdx, int)
             {
-                continue;
-            }
+                games[gameIdx].path = logPaths[firstLog + gameIdx];
+                loadGame(games[gameIdx]);
+            });
 
-            //      ,     
-            float colonyEstimationThreshold = -1.f;
-            for (auto bestEstimateIter = field_.worthToCellSetColonyMap[colonyId].rbegin(); bestEstimateIter != field_.worthToCellSetColonyMap[colonyId].rend(); bestEstimateIter++)
+            std::vector<TurnTask> tasks;
+            for (int gameIdx = 0; gameIdx < int(chunkGamesNb); gameIdx++)
             {
-                //     
-                const std::set<int>& cellsSetWithCurEstimation = bestEstimateIter->second;
-
-                for (int bestEstimateCell : cellsSetWithCurEstimation)
+                if (!games[gameIdx].isValid)
                 {
-                    //          ,      
-                    if (!field_.coloniesBeaconsSetMap[colonyId].count(bestEstimateCell))
-                    {
-                        colonyEstimationThreshold = bestEstimateIter->first * 0.6;
-                        break;
-                    }
+                    std::cerr << "Skipped " << games[gameIdx].path << ": not a turn log" << std::endl;
+                    continue;
                 }
-
-                // if threshold found
-                if (colonyEstimationThreshold > 0)
+                gamesNb++;
+                for (int turn = 0; turn < int(games[gameIdx].turnOffsets.size()); turn++)
                 {
-                    break;
+                    tasks.push_back({ gameIdx, turn });
                 }
             }
 
-            std::cerr << "Estimation threshold for colony " + std::to_string(colonyId) + ": " << colonyEstimationThreshold << std::endl;
-
-            bool existCellWithHighEstimate = true;
-            while (existCellWithHighEstimate)
+            std::vector<TurnResult> turnResults(tasks.size());
+            std::vector<Worker> workers(pool_.threadsNb());
+            pool_.run(int(tasks.size()), [&](int taskIdx, int workerIdx)
             {
-                existCellWithHighEstimate = false;
-
-                float curEstimation = -1.f;
-
-                // find cell with max estimate for that not yet exist in field_.coloniesBeaconsSetMap[colonyId]
-                int cellWithMaxEstimate = -1;
-                for (auto bestEstimateIter = field_.worthToCellSetColonyMap[colonyId].rbegin(); bestEstimateIter != field_.worthToCellSetColonyMap[colonyId].rend(); bestEstimateIter++)
-                {
-                    if (bestEstimateIter->first < colonyEstimationThreshold)
-                    {
-                        break;
-                    }
-
-                    //     
-                    const std::set<int>& cellsSetWithCurEstimation = bestEstimateIter->second;
+                computeTurn(games[tasks[taskIdx].gameIdx], tasks[taskIdx], workers[workerIdx], turnResults[taskIdx]);
+            });
 
-                    for (int bestEstimateCell : cellsSetWithCurEstimation)
-                    {
-                        //          ,        
-                        if (!field_.coloniesBeaconsSetMap[colonyId].count(bestEstimateCell))
-                        {
-                            cellWithMaxEstimate = bestEstimateCell;
-                            curEstimation = bestEstimateIter->first;
-                            break;
-                        }
-                    }
+            for (size_t taskIdx = 0; taskIdx < tasks.size(); taskIdx++)
+            {
+                std::fprintf(results, "%s %d %llu %s\n", games[tasks[taskIdx].gameIdx].path.c_str(), tasks[taskIdx].turn + 1,
+                    static_cast<unsigned long long>(turnResults[taskIdx].ns), turnResults[taskIdx].actions.c_str());
+            }
+            turnsNb += tasks.size();
+        }
+        std::fclose(results);
 
-                    if (cellWithMaxEstimate != -1)
-                    {
-                        break;
-                    }
-                }
+        const double elapsedSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        std::cerr << gamesNb << " games, " << turnsNb << " turns in " << elapsedSec << " s, "
+            << double(turnsNb) / elapsedSec << " turns/s, " << pool_.threadsNb() << " threads" << std::endl;
+        return true;
+    }
 
-                // if cellWithMaxEstimate not found - continue
-                if (cellWithMaxEstimate == -1)
-                {
-                    break;
-                }
+private:
+    static constexpr int kChunkGamesNb = 64;
 
-                std::cerr << "Next cell with high estimation for colony " + std::to_string(colonyId) + ": " << cellWithMaxEstimate << ", estimation " << curEstimation << std::endl;
+    // static map with distances and serialized snapshots of all turns
+    struct GameLog
+    {
+        std::string path;
+        bool isValid{ false };
+        Field map;
+        std::vector<uint8_t> snapshots;
+        std::vector<size_t> turnOffsets;
+    };
 
-                existCellWithHighEstimate = true;
+    struct TurnTask
+    {
+        int gameIdx;
+        int turn;
+    };
 
-                //      ,      
-                //     field_.coloniesBeaconsSetMap[colonyId]
+    struct TurnResult
+    {
+        std::string actions;
+        uint64_t ns;
+    };
 
-                int distToCellWithMaxEstimate = field_.maxFieldDist;
-                int nearestColonyCellToBestCell = -1;
-                for (int beaconCell : field_.coloniesBeaconsSetMap[colonyId])
-                {
-                    int curDist = field_.pathMapVec[beaconCell][cellWithMaxEstimate].size();
-                    if (curDist < distToCellWithMaxEstimate)
-                    {
-                        distToCellWithMaxEstimate = curDist;
-                        nearestColonyCellToBestCell = beaconCell;
-                    }
-                }
+    // bot of the last computed game, most of the tasks of a worker belong to the same game
+    struct Worker
+    {
+        std::unique_ptr<Game> game;
+        const GameLog* gameLog{ nullptr };
+        FieldSnapshot snapshot;
+    };
 
-                // std::cerr << "\tdistToCellWithMaxEstimate: " << distToCellWithMaxEstimate << std::endl;
-                // std::cerr << "\tnearestColonyCellToBestCell: " << nearestColonyCellToBestCell << std::endl;
+    WorkStealingPool pool_;
 
-                // make beacons path without intermediate cells
-                if (distToCellWithMaxEstimate < 2)
-                {
-                    field_.coloniesBeaconsSetMap[colonyId].insert(cellWithMaxEstimate);
-                    continue;
-                }
+    static bool listLogs(const char* logsDir, std::vector<std::string>& logPaths)
+    {
+        DIR* dir = opendir(logsDir);
+        if (!dir)
+        {
+            return false;
+        }
+        while (const dirent* entry = readdir(dir))
+        {
+            if (entry->d_name[0] != '.')
+            {
+                logPaths.push_back(std::string(logsDir) + "/" + entry->d_name);
+            }
+        }
+        closedir(dir);
+        std::sort(logPaths.begin(), logPaths.end());
+        return true;
+    }
 
-                // if dist >= 2 its possible to make OPTIMAL path over other usefull cells
+    // turns are decoded one after another, snapshots keep the resource cells forgotten on previous turns
+    static void loadGame(GameLog& gameLog)
+    {
+        TurnLogReader reader;
+        if (!reader.open(gameLog.path.c_str()))
+        {
+            return;
+        }
+        if (!reader.initField(gameLog.map))
+        {
+            return;
+        }
+        gameLog.map.isDebugLogEnabled = false;
 
-                int maxPossiblePathLength = distToCellWithMaxEstimate + distToCellWithMaxEstimate / 2 + 1;
+        Field turnField;
+        turnField.init(gameLog.map, false);
+        FieldSnapshot snapshot;
+        while (reader.readTurn(turnField))
+        {
+            turnField.forgetEmptyResourceCells();
+            turnField.saveSnapshot(snapshot);
+            gameLog.turnOffsets.push_back(gameLog.snapshots.size());
+            snapshot.serialize(gameLog.snapshots);
+        }
 
-                // find all usefull cells in radius (distToCellWithMaxEstimate) without cell (cellWithMaxEstimate)
-                std::map<float, int> radiusCellWorthMap; // map (worth) -> (cell)
-                //         
-                //  ,      
-                //         radiusCellWorthMap
-                for (const auto& worthCellSetPair : field_.worthToCellSetColonyMap[colonyId])
-                {
-                    float curWorthCellEstimation = worthCellSetPair.first;
-                    for (int curWorthCell : worthCellSetPair.second)
-                    {
-                        // skip cell with max estimate
-                        if (curWorthCell == cellWithMaxEstimate)
-                        {
-                            continue;
-                        }
+        gameLog.map.calcDistances();
+        gameLog.isValid = true;
+    }
 
-                        int distFromNearestColonyCell = int(field_.pathMapVec[nearestColonyCellToBestCell][curWorthCell].size()),
-                            distFromBestCell = int(field_.pathMapVec[cellWithMaxEstimate][curWorthCell].size());
-                        int pathOverCellLength = distFromBestCell + distFromBestCell;
+    static void computeTurn(const GameLog& gameLog, const TurnTask& task, Worker& worker, TurnResult& result)
+    {
+        if (worker.gameLog != &gameLog)
+        {
+            worker.game.reset(new Game(-1, -1));
+            worker.game->field().isDebugLogEnabled = false;
+            worker.game->init(gameLog.map, false);
+            worker.gameLog = &gameLog;
+        }
 
-                        // skip cell with too long dist
-                        if (distFromNearestColonyCell > distToCellWithMaxEstimate
-                            || distFromBestCell > distToCellWithMaxEstimate
-                            || pathOverCellLength > maxPossiblePathLength)
-                        {
-                            continue;
-                        }
+        size_t pos = gameLog.turnOffsets[task.turn];
+        worker.snapshot.deserialize(gameLog.snapshots.data(), gameLog.snapshots.size(), pos);
+        worker.game->field().loadSnapshot(worker.snapshot);
 
-                        float distCoef = pathOverCellLength == 0 ? 2 : (1 / float(pathOverCellLength));
-                        radiusCellWorthMap[curWorthCellEstimation * distCoef] = curWorthCell;
-                    }
-                }
+        const auto startTime = std::chrono::steady_clock::now();
+        worker.game->processTurn();
+        result.ns = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count());
 
-                // if no more useful cells in radius make direct line to nearest colony cell
-                if (radiusCellWorthMap.empty())
-                {
-                    //  allCellsUsedInLines
-                    for (int cell : field_.pathMapVec[nearestColonyCellToBestCell][cellWithMaxEstimate])
-                    {
-                        field_.coloniesBeaconsSetMap[colonyId].insert(cell);
-                    }
-                    continue;
-                }
+        for (const Beacon& beacon : worker.game->turnBeacons())
+        {
+            result.actions += BeaconAction(beacon.cell, beacon.strength).stringify();
+        }
+        if (result.actions.empty())
+        {
+            result.actions = Action().stringify();
+        }
+    }
+};
 
-                // take max useful cell and make path over this cell with beacons
+constexpr int BatchRunner::kChunkGamesNb;
+#endif
 
-                int intermdiateCell = radiusCellWorthMap.rbegin()->second;
-                std::cerr << "Intermdiate Cell for colony " << colonyId << " with max esimation : " << intermdiateCell << std::endl;
+}
 
-                // make line from nearest colony cell to Intermdiate Cell
-                for (int cell : field_.pathMapVec[nearestColonyCellToBestCell][intermdiateCell])
-                {
-                    field_.coloniesBeaconsSetMap[colonyId].insert(cell);
-                }
-                // and then make line from Intermdiate Cell to Cell with max estimate
-                for (int cell : field_.pathMapVec[intermdiateCell][cellWithMaxEstimate])
-                {
-                    field_.coloniesBeaconsSetMap[colonyId].insert(cell);
-                }
-            }
+// tools which include this file as a library define SPRING_CHALLENGE_NO_MAIN
+#ifndef SPRING_CHALLENGE_NO_MAIN
+// --record <file>: also write all input to the binary turn log
+// --replay <file>: play the recorded game instead of reading stdin
+// --batch <dir> [--results <file>] [--threads <n>]: recompute every turn of all logs in the directory
+int main(int argc, char** argv)
+{
+    const char* recordPath = nullptr;
+    const char* replayPath = nullptr;
+    const char* batchDir = nullptr;
+    const char* resultsPath = "batch_results.txt";
+    int threadsNb = 0;
+    for (int argIdx = 1; argIdx + 1 < argc; argIdx += 2)
+    {
+        if (!std::strcmp(argv[argIdx], "--record"))
+        {
+            recordPath = argv[argIdx + 1];
+        }
+        else if (!std::strcmp(argv[argIdx], "--replay"))
+        {
+            replayPath = argv[argIdx + 1];
         }
+        else if (!std::strcmp(argv[argIdx], "--batch"))
+        {
+            batchDir = argv[argIdx + 1];
+        }
+        else if (!std::strcmp(argv[argIdx], "--results"))
+        {
+            resultsPath = argv[argIdx + 1];
+        }
+        else if (!std::strcmp(argv[argIdx], "--threads"))
+        {
+            threadsNb = std::atoi(argv[argIdx + 1]);
+        }
+    }
 
-        // std::cerr << "end tryMakeNewLinesInColonies" << std::endl;
+    if (batchDir)
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        SpringChallenge2023::BatchRunner batchRunner(threadsNb);
+        return batchRunner.run(batchDir, resultsPath) ? 0 : 1;
+#else
+        std::cerr << "Batch mode needs POSIX" << std::endl;
+        return 1;
+#endif
     }
 
-    void setBeacons()
+    if (replayPath)
     {
-        // map cell -> strength
-        std::map<int, int> totalBeaconsMap;
-        for (const auto& colonyPair : field_.turnColoniesMap)
+        SpringChallenge2023::TurnLogReader reader;
+        if (!reader.open(replayPath))
         {
-            const int colonyId = colonyPair.first;
-
-            for (int beaconCell : field_.coloniesBeaconsSetMap[colonyId])
-            {
-                totalBeaconsMap[beaconCell] = 
-                    field_.cells[beaconCell].oppAnts > field_.cells[beaconCell].myAnts ? 8 : 4;
-            }
+            std::cerr << "Can't replay " << replayPath << std::endl;
+            return 1;
         }
-        for (const auto& beaconsPair : totalBeaconsMap)
+        const SpringChallenge2023::TurnLogHeader& header = reader.header();
+        return SpringChallenge2023::withGameCapacity(int(header.cellsNb), int(header.basesNb), [&reader, replayPath](auto gameTag)
         {
-            curTurnActions.push_back(std::make_unique<BeaconAction>(beaconsPair.first, beaconsPair.second));
-        }
+            typename decltype(gameTag)::Type game;
+            if (!game.replay(reader))
+            {
+                std::cerr << "Invalid map in " << replayPath << std::endl;
+                return 1;
+            }
+            return 0;
+        });
     }
 
-    void makeActions()
+    // the cells number goes first, the rest of input is read by the game which fits the map
+    SpringChallenge2023::InputReader input;
+    const int cellsNb = input.readInt();
+    return SpringChallenge2023::withGameCapacity(cellsNb, cellsNb / 2, [&input, cellsNb, recordPath](auto gameTag)
     {
-        curTurnActions.clear();
-        field_.coloniesLinesMap.clear();
-
-        saveActualLinesInColonies();
+        typename decltype(gameTag)::Type game(input);
+        if (recordPath && !game.record(recordPath))
+        {
+            std::cerr << "Can't record to " << recordPath << std::endl;
+        }
+        if (!game.init(cellsNb))
+        {
+            std::cerr << "Invalid map input" << std::endl;
+            return 1;
+        }
+        game.start();
+        return 0;
+    });
+}
+#endif
 
-        tryMakeNewLinesInColonies();
+#ifdef SPRING_CHALLENGE_HEAP_STATS
+// counting global operator new/delete: size header in front of every block
+namespace
+{
 
-        setBeacons();
+constexpr size_t kHeapHeaderSize = alignof(std::max_align_t);
 
-        printActions();
+void* countedAllocate(size_t size) noexcept
+{
+    char* block = static_cast<char*>(std::malloc(size + kHeapHeaderSize));
+    if (!block)
+    {
+        return nullptr;
     }
+    std::memcpy(block, &size, sizeof(size));
+    SpringChallenge2023::HeapCounters::onAllocate(size);
+    return block + kHeapHeaderSize;
+}
 
-public:
-    void init()
+void countedFree(void* ptr) noexcept
+{
+    if (!ptr)
     {
-        field_.init();
-        field_.calcDistances();
+        return;
     }
+    char* block = static_cast<char*>(ptr) - kHeapHeaderSize;
+    size_t size;
+    std::memcpy(&size, block, sizeof(size));
+    SpringChallenge2023::HeapCounters::onFree(size);
+    std::free(block);
+}
 
-    void start()
+}
+
+void* operator new(size_t size)
+{
+    if (void* ptr = countedAllocate(size))
     {
-        while (1)
-        {
-            readTurnState();
-            makeActions();
-        }
+        return ptr;
     }
-};
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return countedAllocate(size);
+}
 
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return countedAllocate(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    countedFree(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    countedFree(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    countedFree(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    countedFree(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+    countedFree(ptr);
 }
 
-int main()
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
 {
-    SpringChallenge2023::Game game;
-    game.init();
-    game.start();
+    countedFree(ptr);
 }
+#endif
@@ -0,0 +1,193 @@
+#pragma once
+
+// Seeded point-symmetric hex maps for the in-process tools.
+// Include after main.cpp, compiled with SPRING_CHALLENGE_NO_MAIN
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace SpringChallenge2023
+{
+
+struct MapParams
+{
+    int radius{ 6 };
+    int basesNb{ 1 };
+    // part of symmetric cell pairs with resources, eggs part of them
+    double resourcesDensity{ 0.45 };
+    double eggsPart{ 0.45 };
+};
+
+// cells number of the hexagon map with the given radius
+inline int hexMapCellsNb(int radius)
+{
+    return 3 * radius * (radius + 1) + 1;
+}
+
+// minimal radius of the hexagon map with at least cellsNb cells
+inline int hexMapRadius(int cellsNb)
+{
+    int radius = 1;
+    while (hexMapCellsNb(radius) < cellsNb)
+    {
+        radius++;
+    }
+    return radius;
+}
+
+// hexagon of the given radius in axial coordinates: cell 0 is the center, cells 2k+1 and 2k+2
+// are point-symmetric; neighbours follow the referee order, direction d is opposite to (d + 3) % 6;
+// the first player gets the odd cell of every base pair, opponent gets the symmetric one
+inline void generateMap(uint32_t seed, const MapParams& params, Field& field)
+{
+    static const std::array<std::pair<int, int>, 6> kDirs{ {
+        { 1, 0 }, { 1, -1 }, { 0, -1 }, { -1, 0 }, { -1, 1 }, { 0, 1 } } };
+
+    // axial coordinates of cells and dense (2 * radius + 1)^2 grid of cell indices
+    const int radius = std::max(params.radius, 1);
+    const int gridSide = 2 * radius + 1;
+    auto gridIdx = [radius, gridSide](int q, int r) { return (q + radius) * gridSide + r + radius; };
+    auto isInside = [radius](int q, int r) { return std::abs(q) <= radius && std::abs(r) <= radius && std::abs(q + r) <= radius; };
+
+    std::vector<std::pair<int, int>> coords;
+    coords.reserve(size_t(hexMapCellsNb(radius)));
+    coords.push_back({ 0, 0 });
+    std::vector<int> gridCells(size_t(gridSide) * gridSide, -1);
+    gridCells[gridIdx(0, 0)] = 0;
+    for (int q = -radius; q <= radius; q++)
+    {
+        for (int r = -radius; r <= radius; r++)
+        {
+            if (!isInside(q, r) || gridCells[gridIdx(q, r)] != -1)
+            {
+                continue;
+            }
+            for (const std::pair<int, int>& coord : { std::make_pair(q, r), std::make_pair(-q, -r) })
+            {
+                gridCells[gridIdx(coord.first, coord.second)] = int(coords.size());
+                coords.push_back(coord);
+            }
+        }
+    }
+
+    field.initCells(int(coords.size()));
+    for (int cell = 0; cell < field.numberOfCells; cell++)
+    {
+        for (int dir = 0; dir < 6; dir++)
+        {
+            const int neighQ = coords[cell].first + kDirs[dir].first;
+            const int neighR = coords[cell].second + kDirs[dir].second;
+            if (isInside(neighQ, neighR))
+            {
+                field.neighs[dir][cell] = gridCells[gridIdx(neighQ, neighR)];
+            }
+        }
+    }
+
+    std::mt19937 rng{ seed };
+    const int pairsNb = field.numberOfCells / 2;
+    std::vector<int> pairs(pairsNb);
+    for (int pairIdx = 0; pairIdx < pairsNb; pairIdx++)
+    {
+        pairs[pairIdx] = 2 * pairIdx + 1;
+    }
+    std::shuffle(pairs.begin(), pairs.end(), rng);
+
+    // shuffled pairs: bases first, then at least one eggs and one crystals pair, then random resources
+    const int basesNb = std::max(1, std::min(params.basesNb, pairsNb - 2));
+    std::uniform_real_distribution<double> chance{ 0., 1. };
+    for (int pairIdx = basesNb; pairIdx < pairsNb; pairIdx++)
+    {
+        Cell::Type type = Cell::Nothing;
+        if (pairIdx == basesNb)
+        {
+            type = Cell::Egg;
+        }
+        else if (pairIdx == basesNb + 1)
+        {
+            type = Cell::Crystal;
+        }
+        else if (chance(rng) < params.resourcesDensity)
+        {
+            type = chance(rng) < params.eggsPart ? Cell::Egg : Cell::Crystal;
+        }
+        if (type == Cell::Nothing)
+        {
+            continue;
+        }
+
+        std::uniform_int_distribution<int> resources{ type == Cell::Egg ? 10 : 20, type == Cell::Egg ? 30 : 80 };
+        const int cellResources = resources(rng);
+        for (int cell : { pairs[pairIdx], pairs[pairIdx] + 1 })
+        {
+            field.cellTypes[cell] = type;
+            field.initialResources[cell] = cellResources;
+        }
+    }
+
+    field.numberOfBases = basesNb;
+    field.friendlyBases.resize(basesNb);
+    field.opponentBases.resize(basesNb);
+    for (int baseIdx = 0; baseIdx < basesNb; baseIdx++)
+    {
+        field.friendlyBases[baseIdx] = pairs[baseIdx];
+        field.opponentBases[baseIdx] = pairs[baseIdx] + 1;
+    }
+
+    field.finishInit();
+}
+
+// static map data in the init protocol read by Field::init: cells number, type, resources
+// and six neighbours (-1 for none) of every cell, bases number, friendly and opponent bases
+inline void appendMapInit(const Field& field, std::string& text)
+{
+    auto appendInt = [&text](int value, char separator)
+    {
+        char digits[16];
+        int digitsNb = 0;
+        unsigned absValue = value < 0 ? 0u - unsigned(value) : unsigned(value);
+        do
+        {
+            digits[digitsNb++] = char('0' + absValue % 10);
+            absValue /= 10;
+        } while (absValue);
+        if (value < 0)
+        {
+            text += '-';
+        }
+        while (digitsNb)
+        {
+            text += digits[--digitsNb];
+        }
+        text += separator;
+    };
+
+    text.reserve(text.size() + size_t(field.numberOfCells) * 32);
+    appendInt(field.numberOfCells, '\n');
+    for (int cell = 0; cell < field.numberOfCells; cell++)
+    {
+        appendInt(field.cellTypes[cell], ' ');
+        appendInt(field.initialResources[cell], ' ');
+        for (int dir = 0; dir < 6; dir++)
+        {
+            const int neighCell = field.neighs[dir][cell];
+            appendInt(neighCell == field.numberOfCells ? -1 : neighCell, dir == 5 ? '\n' : ' ');
+        }
+    }
+    appendInt(field.numberOfBases, '\n');
+    for (const std::vector<int>* bases : { &field.friendlyBases, &field.opponentBases })
+    {
+        for (size_t baseIdx = 0; baseIdx < bases->size(); baseIdx++)
+        {
+            appendInt((*bases)[baseIdx], baseIdx + 1 == bases->size() ? '\n' : ' ');
+        }
+    }
+}
+
+}
@@ -0,0 +1,392 @@
+#pragma once
+
+// In-process referee for the SpringChallenge2023 rules.
+// Include after main.cpp, compiled with SPRING_CHALLENGE_NO_MAIN
+
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace SpringChallenge2023
+{
+
+// whole mutable game state, one flat array - cheap to copy
+struct SimState
+{
+    int turn{ 0 };
+    std::array<int, 2> scores{};
+    // per cell: resources, ants of player 0, ants of player 1
+    std::vector<int> cellsData;
+
+    int& resources(int cell) { return cellsData[3 * cell]; }
+    int resources(int cell) const { return cellsData[3 * cell]; }
+    int& ants(int player, int cell) { return cellsData[3 * cell + 1 + player]; }
+    int ants(int player, int cell) const { return cellsData[3 * cell + 1 + player]; }
+};
+
+// game rules over the map Field (player 0 perspective, distances calculated):
+// - ants of every player are shared between beacons proportionally to their strengths,
+//   ant groups are assigned to the nearest beacons first and move one cell along the shortest path
+// - on cells with ants of both players the player with the weaker attack chain loses up to kAttackLosses ants
+// - every player harvests resource cells through its harvest chain: min(chain, resources),
+//   harvested eggs hatch as new ants at the player's bases, harvested crystals are score
+// - chain value of a cell is the max over paths from own base through own ants of the min ants on the path
+// - game ends when somebody has more than half of all crystals, crystals are over or after kMaxTurns turns
+class Simulator
+{
+public:
+    static constexpr int kMaxTurns = 100;
+    static constexpr int kAttackLosses = 10;
+
+    explicit Simulator(const Field& mapField):
+        map_{ mapField }
+    {
+        const int cellsNb = map_.numberOfCells;
+        for (int player = 0; player < 2; player++)
+        {
+            chains_[player].resize(cellsNb);
+            bases_[player] = player == 0 ? map_.friendlyBases : map_.opponentBases;
+        }
+        movedAnts_.resize(cellsNb);
+        antCells_.reserve(cellsNb);
+        heap_.reserve(size_t(cellsNb) * 6);
+        distBuckets_.resize(map_.maxFieldDist + 1);
+
+        for (int cell = 0; cell < cellsNb; cell++)
+        {
+            if (map_.cellTypes[cell] == Cell::Crystal)
+            {
+                totalCrystalsNb_ += map_.initialResources[cell];
+            }
+        }
+    }
+
+    SimState initialState(int antsPerBase) const
+    {
+        SimState state;
+        state.cellsData.assign(size_t(map_.numberOfCells) * 3, 0);
+        for (int cell = 0; cell < map_.numberOfCells; cell++)
+        {
+            state.resources(cell) = map_.initialResources[cell];
+        }
+        for (int player = 0; player < 2; player++)
+        {
+            for (int base : bases_[player])
+            {
+                state.ants(player, base) = antsPerBase;
+            }
+        }
+        return state;
+    }
+
+    // turn state as the player's bot sees it
+    void fillField(const SimState& state, int player, Field& field) const
+    {
+        for (int cell = 0; cell < map_.numberOfCells; cell++)
+        {
+            field.curResources[cell] = state.resources(cell);
+            field.myAnts[cell] = state.ants(player, cell);
+            field.oppAnts[cell] = state.ants(1 - player, cell);
+        }
+        field.finishTurnState();
+    }
+
+    void step(SimState& state, const std::vector<Beacon>& beacons0, const std::vector<Beacon>& beacons1)
+    {
+        moveAnts(state, 0, beacons0);
+        moveAnts(state, 1, beacons1);
+
+        calcChains(state);
+        attack(state);
+
+        calcChains(state);
+        harvest(state);
+
+        state.turn++;
+    }
+
+    bool isOver(const SimState& state) const
+    {
+        if (state.turn >= kMaxTurns
+            || state.scores[0] * 2 > totalCrystalsNb_
+            || state.scores[1] * 2 > totalCrystalsNb_)
+        {
+            return true;
+        }
+        for (int cell = 0; cell < map_.numberOfCells; cell++)
+        {
+            if (map_.cellTypes[cell] == Cell::Crystal && state.resources(cell))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // winner by crystals, then by ants; -1 on draw
+    int winner(const SimState& state) const
+    {
+        if (state.scores[0] != state.scores[1])
+        {
+            return state.scores[0] > state.scores[1] ? 0 : 1;
+        }
+        std::array<int, 2> totalAnts{};
+        for (int cell = 0; cell < map_.numberOfCells; cell++)
+        {
+            totalAnts[0] += state.ants(0, cell);
+            totalAnts[1] += state.ants(1, cell);
+        }
+        if (totalAnts[0] != totalAnts[1])
+        {
+            return totalAnts[0] > totalAnts[1] ? 0 : 1;
+        }
+        return -1;
+    }
+
+    const Field& map() const { return map_; }
+
+private:
+    struct AntsMove
+    {
+        int antCell;
+        int beaconIdx;
+    };
+
+    const Field& map_;
+    int totalCrystalsNb_{ 0 };
+    std::array<std::vector<int>, 2> bases_;
+    std::array<std::vector<int>, 2> chains_;
+    std::vector<int> movedAnts_;
+    std::vector<int> antCells_;
+    std::vector<int> beaconNeeds_;
+    std::vector<std::pair<int, int>> heap_;
+    std::vector<std::vector<AntsMove>> distBuckets_;
+
+    void moveAnts(SimState& state, int player, const std::vector<Beacon>& beacons)
+    {
+        int totalStrength = 0;
+        for (const Beacon& beacon : beacons)
+        {
+            totalStrength += beacon.strength;
+        }
+
+        int totalAnts = 0;
+        antCells_.clear();
+        for (int cell = 0; cell < map_.numberOfCells; cell++)
+        {
+            if (state.ants(player, cell))
+            {
+                antCells_.push_back(cell);
+                totalAnts += state.ants(player, cell);
+            }
+        }
+        if (!totalStrength || !totalAnts)
+        {
+            return;
+        }
+
+        // ants needed by every beacon, remainder goes to the first beacons
+        beaconNeeds_.resize(beacons.size());
+        int allocatedAnts = 0;
+        for (size_t beaconIdx = 0; beaconIdx < beacons.size(); beaconIdx++)
+        {
+            beaconNeeds_[beaconIdx] = int(int64_t(totalAnts) * beacons[beaconIdx].strength / totalStrength);
+            allocatedAnts += beaconNeeds_[beaconIdx];
+        }
+        for (size_t beaconIdx = 0; allocatedAnts < totalAnts; beaconIdx = (beaconIdx + 1) % beacons.size())
+        {
+            if (beacons[beaconIdx].strength)
+            {
+                beaconNeeds_[beaconIdx]++;
+                allocatedAnts++;
+            }
+        }
+
+        // nearest pairs of ant cell and beacon first: bucket sort by distance
+        for (std::vector<AntsMove>& bucket : distBuckets_)
+        {
+            bucket.clear();
+        }
+        for (int antCell : antCells_)
+        {
+            for (size_t beaconIdx = 0; beaconIdx < beacons.size(); beaconIdx++)
+            {
+                const int dist = map_.dist(antCell, beacons[beaconIdx].cell);
+                if (dist < int(distBuckets_.size()))
+                {
+                    distBuckets_[dist].push_back({ antCell, int(beaconIdx) });
+                }
+            }
+        }
+
+        std::fill(movedAnts_.begin(), movedAnts_.end(), 0);
+        for (const std::vector<AntsMove>& bucket : distBuckets_)
+        {
+            for (const AntsMove& move : bucket)
+            {
+                int& cellAnts = state.ants(player, move.antCell);
+                const int movingAnts = std::min(cellAnts, beaconNeeds_[move.beaconIdx]);
+                if (!movingAnts)
+                {
+                    continue;
+                }
+                cellAnts -= movingAnts;
+                beaconNeeds_[move.beaconIdx] -= movingAnts;
+
+                const int beaconCell = beacons[move.beaconIdx].cell;
+                const int dstCell = move.antCell == beaconCell ? beaconCell : map_.nextCell(move.antCell, beaconCell);
+                movedAnts_[dstCell] += movingAnts;
+            }
+        }
+
+        // not allocated ants stay
+        for (int cell = 0; cell < map_.numberOfCells; cell++)
+        {
+            state.ants(player, cell) += movedAnts_[cell];
+        }
+    }
+
+    // widest path from player bases through cells with player ants
+    void calcChains(const SimState& state)
+    {
+        for (int player = 0; player < 2; player++)
+        {
+            std::vector<int>& chain = chains_[player];
+            std::fill(chain.begin(), chain.end(), 0);
+
+            heap_.clear();
+            for (int base : bases_[player])
+            {
+                if (state.ants(player, base) > chain[base])
+                {
+                    chain[base] = state.ants(player, base);
+                    heap_.push_back({ chain[base], base });
+                }
+            }
+            std::make_heap(heap_.begin(), heap_.end());
+
+            while (!heap_.empty())
+            {
+                std::pop_heap(heap_.begin(), heap_.end());
+                const std::pair<int, int> top = heap_.back();
+                heap_.pop_back();
+                if (top.first != chain[top.second])
+                {
+                    continue;
+                }
+
+                for (const std::vector<int>& dirNeighs : map_.neighs)
+                {
+                    const int neighCell = dirNeighs[top.second];
+                    if (neighCell == map_.numberOfCells)
+                    {
+                        continue;
+                    }
+                    const int neighChain = std::min(top.first, state.ants(player, neighCell));
+                    if (neighChain > chain[neighCell])
+                    {
+                        chain[neighCell] = neighChain;
+                        heap_.push_back({ neighChain, neighCell });
+                        std::push_heap(heap_.begin(), heap_.end());
+                    }
+                }
+            }
+        }
+    }
+
+    void attack(SimState& state)
+    {
+        for (int cell = 0; cell < map_.numberOfCells; cell++)
+        {
+            if (!state.ants(0, cell) || !state.ants(1, cell) || chains_[0][cell] == chains_[1][cell])
+            {
+                continue;
+            }
+            const int loser = chains_[0][cell] > chains_[1][cell] ? 1 : 0;
+            int& loserAnts = state.ants(loser, cell);
+            loserAnts -= std::min(loserAnts, int(kAttackLosses));
+        }
+    }
+
+    void harvest(SimState& state)
+    {
+        std::array<int, 2> hatchedAnts{};
+        for (int cell = 0; cell < map_.numberOfCells; cell++)
+        {
+            int& resources = state.resources(cell);
+            if (!resources)
+            {
+                continue;
+            }
+
+            std::array<int, 2> harvested{ std::min(chains_[0][cell], resources), std::min(chains_[1][cell], resources) };
+            // not enough for both: resources are shared proportionally
+            if (harvested[0] + harvested[1] > resources)
+            {
+                const int total = harvested[0] + harvested[1];
+                const int resourcesBefore = resources;
+                harvested[0] = resourcesBefore * harvested[0] / total;
+                harvested[1] = resourcesBefore * harvested[1] / total;
+            }
+            resources -= harvested[0] + harvested[1];
+
+            for (int player = 0; player < 2; player++)
+            {
+                if (map_.cellTypes[cell] == Cell::Crystal)
+                {
+                    state.scores[player] += harvested[player];
+                }
+                else
+                {
+                    hatchedAnts[player] += harvested[player];
+                }
+            }
+        }
+
+        for (int player = 0; player < 2; player++)
+        {
+            const int basesNb = int(bases_[player].size());
+            for (int baseIdx = 0; baseIdx < basesNb; baseIdx++)
+            {
+                state.ants(player, bases_[player][baseIdx]) += hatchedAnts[player] / basesNb + (baseIdx < hatchedAnts[player] % basesNb ? 1 : 0);
+            }
+        }
+    }
+};
+
+struct MatchResult
+{
+    int winner;
+    std::array<int, 2> scores;
+    int turns;
+};
+
+// whole game between two bots, which run in-process on the same state
+inline MatchResult playMatch(Simulator& simulator, Game& player0, Game& player1, int antsPerBase = 10)
+{
+    SimState state = simulator.initialState(antsPerBase);
+    std::array<Game*, 2> players{ &player0, &player1 };
+
+    while (!simulator.isOver(state))
+    {
+        for (int player = 0; player < 2; player++)
+        {
+            simulator.fillField(state, player, players[player]->field());
+            players[player]->processTurn();
+        }
+        simulator.step(state, player0.turnBeacons(), player1.turnBeacons());
+    }
+
+    return { simulator.winner(state), state.scores, state.turn };
+}
+
+// bots prepared for the in-process match: quiet, without real input/output
+inline std::unique_ptr<Game> makeSimulatedGame(const Field& mapField, bool isSecondPlayer)
+{
+    std::unique_ptr<Game> game{ new Game(-1, -1) };
+    game->field().isDebugLogEnabled = false;
+    game->init(mapField, isSecondPlayer);
+    return game;
+}
+
+}
@@ -0,0 +1,484 @@
+// Microbenchmarks of every phase of the bot on generated maps of several sizes.
+// Reports ns/op, allocations/op and bytes/op; results can be saved as JSON and compared with a baseline.
+// Usage: bench [--sizes R1,R2,...] [--filter substring] [--min-time seconds] [--json file]
+//              [--compare baseline.json] [--tolerance ratio]
+
+#define SPRING_CHALLENGE_NO_MAIN
+#include "../main.cpp"
+#include "MapGenerator.h"
+#include "Simulator.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <new>
+
+namespace
+{
+
+// every allocation of the process is counted, benchmarks read the difference around the measured code
+std::atomic<uint64_t> allocationsNb{ 0 };
+std::atomic<uint64_t> allocatedBytes{ 0 };
+
+// all overloads allocate with malloc and free with free, so every pointer goes back to its own allocator
+void* countedAllocate(size_t size)
+{
+    allocationsNb.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+}
+
+void* operator new(size_t size)
+{
+    return countedAllocate(size);
+}
+
+void* operator new[](size_t size)
+{
+    return countedAllocate(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace SpringChallenge2023
+{
+
+// access to the private phases of Game
+struct GamePhases
+{
+    static void saveActualLines(Game& game) { game.saveActualLinesInColonies(); }
+    static void tryMakeNewLines(Game& game) { game.tryMakeNewLinesInColonies(); }
+    static void setBeacons(Game& game) { game.setBeacons(); }
+    static void printActions(Game& game) { game.printActions(); }
+};
+
+}
+
+using namespace SpringChallenge2023;
+
+namespace
+{
+
+struct BenchResult
+{
+    std::string name;
+    int cellsNb;
+    long long iterationsNb;
+    double nsPerOp;
+    double allocsPerOp;
+    double bytesPerOp;
+};
+
+struct BenchOptions
+{
+    std::vector<int> radii{ 4, 8, 16, 32 };
+    std::string filter;
+    double minTimeSec{ 0.2 };
+};
+
+// setup prepares the state for one operation and isn't measured
+BenchResult runBench(const BenchOptions& options, const std::string& name, int cellsNb,
+    const std::function<void()>& setup, const std::function<void()>& op)
+{
+    setup();
+    op();
+
+    long long iterationsNb = 0;
+    uint64_t totalNs = 0;
+    uint64_t totalAllocs = 0;
+    uint64_t totalBytes = 0;
+    const uint64_t minTimeNs = uint64_t(options.minTimeSec * 1e9);
+    while (totalNs < minTimeNs || iterationsNb < 3)
+    {
+        setup();
+
+        const uint64_t allocsBefore = allocationsNb.load(std::memory_order_relaxed);
+        const uint64_t bytesBefore = allocatedBytes.load(std::memory_order_relaxed);
+        const auto startTime = std::chrono::steady_clock::now();
+        op();
+        const auto endTime = std::chrono::steady_clock::now();
+        totalAllocs += allocationsNb.load(std::memory_order_relaxed) - allocsBefore;
+        totalBytes += allocatedBytes.load(std::memory_order_relaxed) - bytesBefore;
+
+        totalNs += uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count());
+        iterationsNb++;
+    }
+
+    const double opsNb = double(iterationsNb);
+    return { name, cellsNb, iterationsNb, double(totalNs) / opsNb, double(totalAllocs) / opsNb, double(totalBytes) / opsNb };
+}
+
+// per-turn input of the first player in the protocol format
+std::string turnStateText(const Simulator& simulator, const SimState& state)
+{
+    std::string text;
+    for (int cell = 0; cell < simulator.map().numberOfCells; cell++)
+    {
+        text += std::to_string(state.resources(cell)) + ' ' + std::to_string(state.ants(0, cell)) + ' '
+            + std::to_string(state.ants(1, cell)) + '\n';
+    }
+    return text;
+}
+
+// turn input in a file which stays in the page cache, read again after rewind
+struct TurnInputFile
+{
+    FILE* file;
+    std::unique_ptr<InputReader> input;
+
+    explicit TurnInputFile(const std::string& text):
+        file{ std::tmpfile() }
+    {
+        std::fwrite(text.data(), 1, text.size(), file);
+        std::fflush(file);
+        input.reset(new InputReader(fileno(file)));
+    }
+
+    ~TurnInputFile()
+    {
+        std::fclose(file);
+    }
+
+    void rewind()
+    {
+        lseek(input->fd, 0, SEEK_SET);
+        input->pos = 0;
+        input->len = 0;
+        input->eof = false;
+        input->isTruncated = false;
+    }
+};
+
+void benchMap(const BenchOptions& options, int radius, std::vector<BenchResult>& results)
+{
+    auto isSelected = [&options](const std::string& name)
+    {
+        return options.filter.empty() || name.find(options.filter) != std::string::npos;
+    };
+    auto add = [&](const std::string& name, int cellsNb, const std::function<void()>& setup, const std::function<void()>& op)
+    {
+        if (isSelected(name))
+        {
+            results.push_back(runBench(options, name, cellsNb, setup, op));
+            const BenchResult& result = results.back();
+            std::fprintf(stderr, "%-24s %6d cells %14.0f ns/op %10.1f allocs/op %12.0f B/op %8lld iterations\n",
+                result.name.c_str(), result.cellsNb, result.nsPerOp, result.allocsPerOp, result.bytesPerOp, result.iterationsNb);
+        }
+    };
+    auto noSetup = []() {};
+
+    MapParams mapParams;
+    mapParams.radius = radius;
+    mapParams.basesNb = std::max(1, radius / 4);
+    Field mapField;
+    generateMap(uint32_t(radius), mapParams, mapField);
+    const int cellsNb = mapField.numberOfCells;
+
+    Field distancesField;
+    distancesField.init(mapField, false);
+    add("calcDistances", cellsNb, noSetup, [&distancesField]() { distancesField.calcDistances(); });
+    mapField.calcDistances();
+
+    // mid-game state: the bot plays against itself for a part of the map radius turns
+    Simulator simulator(mapField);
+    std::unique_ptr<Game> game = makeSimulatedGame(mapField, false);
+    std::unique_ptr<Game> opponent = makeSimulatedGame(mapField, true);
+    SimState state = simulator.initialState(10);
+    for (int turn = 0; turn < 2 * radius && !simulator.isOver(state); turn++)
+    {
+        simulator.fillField(state, 0, game->field());
+        game->processTurn();
+        simulator.fillField(state, 1, opponent->field());
+        opponent->processTurn();
+        simulator.step(state, game->turnBeacons(), opponent->turnBeacons());
+    }
+
+    Field& field = game->field();
+    Game& bot = *game;
+
+    // turn state which isn't a continuation of the previous one: all cells are dirty, colonies are rebuilt,
+    // worths are estimated and lines are built for every colony
+    TurnInputFile turnInput(turnStateText(simulator, state));
+    add("fullReadTurnState", cellsNb,
+        [&field, &turnInput]()
+        {
+            field.invalidateTurnState();
+            turnInput.rewind();
+        },
+        [&field, &turnInput]() { field.readTurnState(*turnInput.input); });
+
+    auto invalidateTurn = [&field]()
+    {
+        field.invalidateTurnState();
+        field.finishTurnState();
+    };
+    add("fullBuildColonies", cellsNb, invalidateTurn, [&field]() { field.buildColonies(); });
+    add("fullMakeTurnEstimation", cellsNb,
+        [&invalidateTurn, &field]()
+        {
+            invalidateTurn();
+            field.buildColonies();
+        },
+        [&field]() { field.makeTurnEstimation(); });
+    add("fullTurnUpdate", cellsNb, [&field]() { field.invalidateTurnState(); },
+        [&field]()
+        {
+            field.finishTurnState();
+            field.buildColonies();
+            field.makeTurnEstimation();
+        });
+
+    // lines phases take memory from the turn arena, so every operation starts a new turn
+    auto startTurn = [&invalidateTurn, &field]()
+    {
+        invalidateTurn();
+        field.buildColonies();
+        field.makeTurnEstimation();
+    };
+    add("fullSaveActualLines", cellsNb, startTurn, [&bot]() { GamePhases::saveActualLines(bot); });
+    add("tryMakeNewLines", cellsNb,
+        [&startTurn, &bot]()
+        {
+            startTurn();
+            GamePhases::saveActualLines(bot);
+        },
+        [&bot]() { GamePhases::tryMakeNewLines(bot); });
+
+    // next turn of a real game: the bot has played the previous turn in full, the turn state differs
+    // by one simulated step and the derived data are updated incrementally; states of two consecutive turns
+    // alternate, the phases of the turn before and after the measured ones run in setup
+    SimState nextState = state;
+    simulator.fillField(state, 0, field);
+    bot.processTurn();
+    simulator.fillField(state, 1, opponent->field());
+    opponent->processTurn();
+    simulator.step(nextState, bot.turnBeacons(), opponent->turnBeacons());
+
+    TurnInputFile nextTurnInput(turnStateText(simulator, nextState));
+    // the bot has played the turn of turnInputs[turnIdx]
+    TurnInputFile* turnInputs[2] = { &nextTurnInput, &turnInput };
+    int turnIdx = 1;
+
+    enum TurnPhase { ReadTurnState, BuildColonies, MakeTurnEstimation, SaveActualLines, MakeNewLines, TurnPhasesNb };
+    const std::function<void()> turnPhases[TurnPhasesNb] = {
+        [&field, &turnInputs, &turnIdx]() { field.readTurnState(*turnInputs[turnIdx]->input); },
+        [&field]() { field.buildColonies(); },
+        [&field]() { field.makeTurnEstimation(); },
+        [&bot]() { GamePhases::saveActualLines(bot); },
+        [&bot]()
+        {
+            GamePhases::tryMakeNewLines(bot);
+            GamePhases::setBeacons(bot);
+        } };
+    int nextPhase = TurnPhasesNb;
+    auto runPhasesTo = [&turnPhases, &nextPhase](int lastPhase)
+    {
+        while (nextPhase < lastPhase)
+        {
+            turnPhases[nextPhase++]();
+        }
+    };
+    auto addNextTurn = [&](const std::string& name, int firstPhase, int lastPhase)
+    {
+        add(name, cellsNb,
+            [&, firstPhase]()
+            {
+                runPhasesTo(TurnPhasesNb);
+                turnIdx ^= 1;
+                turnInputs[turnIdx]->rewind();
+                nextPhase = ReadTurnState;
+                runPhasesTo(firstPhase);
+            },
+            [&, lastPhase]() { runPhasesTo(lastPhase); });
+    };
+    addNextTurn("readTurnState", ReadTurnState, BuildColonies);
+    addNextTurn("buildColonies", BuildColonies, MakeTurnEstimation);
+    addNextTurn("makeTurnEstimation", MakeTurnEstimation, SaveActualLines);
+    addNextTurn("saveActualLines", SaveActualLines, MakeNewLines);
+    addNextTurn("nextTurnUpdate", ReadTurnState, SaveActualLines);
+    runPhasesTo(TurnPhasesNb);
+
+    // actions are really written, to /dev/null
+    GamePhases::setBeacons(bot);
+    const int nullFd = open("/dev/null", O_WRONLY);
+    Game printingGame(-1, nullFd);
+    printingGame.field().isDebugLogEnabled = false;
+    printingGame.init(mapField, false);
+    simulator.fillField(state, 0, printingGame.field());
+    printingGame.processTurn();
+    add("printActions", cellsNb, noSetup, [&printingGame]() { GamePhases::printActions(printingGame); });
+    close(nullFd);
+}
+
+void writeJson(const std::vector<BenchResult>& results, FILE* output)
+{
+    std::fprintf(output, "[\n");
+    for (size_t resultIdx = 0; resultIdx < results.size(); resultIdx++)
+    {
+        const BenchResult& result = results[resultIdx];
+        std::fprintf(output, "  {\"name\": \"%s\", \"cells\": %d, \"iterations\": %lld, \"ns_per_op\": %.1f, \"allocs_per_op\": %.2f, \"bytes_per_op\": %.1f}%s\n",
+            result.name.c_str(), result.cellsNb, result.iterationsNb, result.nsPerOp, result.allocsPerOp, result.bytesPerOp,
+            resultIdx + 1 == results.size() ? "" : ",");
+    }
+    std::fprintf(output, "]\n");
+}
+
+// reads the records written by writeJson, one benchmark per line
+bool readJson(const char* path, std::vector<BenchResult>& results)
+{
+    FILE* input = std::fopen(path, "r");
+    if (!input)
+    {
+        return false;
+    }
+    char line[512];
+    while (std::fgets(line, sizeof(line), input))
+    {
+        char name[128];
+        BenchResult result;
+        if (std::sscanf(line, " {\"name\": \"%127[^\"]\", \"cells\": %d, \"iterations\": %lld, \"ns_per_op\": %lf, \"allocs_per_op\": %lf, \"bytes_per_op\": %lf",
+            name, &result.cellsNb, &result.iterationsNb, &result.nsPerOp, &result.allocsPerOp, &result.bytesPerOp) == 6)
+        {
+            result.name = name;
+            results.push_back(result);
+        }
+    }
+    std::fclose(input);
+    return true;
+}
+
+// regression: time grew more than tolerance times or the number of allocations grew
+int compareResults(const std::vector<BenchResult>& baseline, const std::vector<BenchResult>& results, double tolerance)
+{
+    int regressionsNb = 0;
+    for (const BenchResult& result : results)
+    {
+        for (const BenchResult& base : baseline)
+        {
+            if (base.name != result.name || base.cellsNb != result.cellsNb)
+            {
+                continue;
+            }
+            const double timeRatio = result.nsPerOp / std::max(base.nsPerOp, 1.);
+            const bool isRegression = timeRatio > tolerance || result.allocsPerOp > base.allocsPerOp + 0.5;
+            regressionsNb += isRegression;
+            std::printf("%-20s %6d cells %8.2fx time %10.1f -> %-10.1f allocs %s\n", result.name.c_str(), result.cellsNb,
+                timeRatio, base.allocsPerOp, result.allocsPerOp, isRegression ? "REGRESSION" : "ok");
+        }
+    }
+    return regressionsNb;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    const char* jsonPath = nullptr;
+    const char* baselinePath = nullptr;
+    double tolerance = 1.2;
+
+    for (int argIdx = 1; argIdx < argc; argIdx++)
+    {
+        const bool hasValue = argIdx + 1 < argc;
+        if (hasValue && !std::strcmp(argv[argIdx], "--sizes"))
+        {
+            options.radii.clear();
+            for (const char* radius = argv[++argIdx]; *radius; radius += *radius == ',')
+            {
+                char* radiusEnd;
+                options.radii.push_back(int(std::strtol(radius, &radiusEnd, 10)));
+                radius = radiusEnd;
+            }
+        }
+        else if (hasValue && !std::strcmp(argv[argIdx], "--filter"))
+        {
+            options.filter = argv[++argIdx];
+        }
+        else if (hasValue && !std::strcmp(argv[argIdx], "--min-time"))
+        {
+            options.minTimeSec = std::atof(argv[++argIdx]);
+        }
+        else if (hasValue && !std::strcmp(argv[argIdx], "--json"))
+        {
+            jsonPath = argv[++argIdx];
+        }
+        else if (hasValue && !std::strcmp(argv[argIdx], "--compare"))
+        {
+            baselinePath = argv[++argIdx];
+        }
+        else if (hasValue && !std::strcmp(argv[argIdx], "--tolerance"))
+        {
+            tolerance = std::atof(argv[++argIdx]);
+        }
+        else
+        {
+            std::fprintf(stderr, "Usage: %s [--sizes R1,R2,...] [--filter substring] [--min-time seconds] [--json file]\n"
+                "       [--compare baseline.json] [--tolerance ratio]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<BenchResult> results;
+    for (int radius : options.radii)
+    {
+        benchMap(options, radius, results);
+    }
+
+    if (jsonPath)
+    {
+        FILE* output = std::fopen(jsonPath, "w");
+        if (!output)
+        {
+            std::fprintf(stderr, "Can't open %s\n", jsonPath);
+            return 1;
+        }
+        writeJson(results, output);
+        std::fclose(output);
+    }
+
+    if (baselinePath)
+    {
+        std::vector<BenchResult> baseline;
+        if (!readJson(baselinePath, baseline))
+        {
+            std::fprintf(stderr, "Can't read %s\n", baselinePath);
+            return 1;
+        }
+        const int regressionsNb = compareResults(baseline, results, tolerance);
+        if (regressionsNb)
+        {
+            std::printf("%d regressions\n", regressionsNb);
+            return 2;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,84 @@
+// Writes a generated map in the init protocol format, to stdout or to a file.
+// Usage: mapgen [--radius R | --cells N] [--bases B] [--density D] [--eggs E] [--seed S] [-o file]
+
+#define SPRING_CHALLENGE_NO_MAIN
+#include "../main.cpp"
+#include "MapGenerator.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace SpringChallenge2023;
+
+int main(int argc, char** argv)
+{
+    MapParams params;
+    uint32_t seed = 1;
+    const char* outputPath = nullptr;
+
+    for (int argIdx = 1; argIdx < argc; argIdx++)
+    {
+        const bool hasValue = argIdx + 1 < argc;
+        if (hasValue && !std::strcmp(argv[argIdx], "--radius"))
+        {
+            params.radius = std::atoi(argv[++argIdx]);
+        }
+        else if (hasValue && !std::strcmp(argv[argIdx], "--cells"))
+        {
+            params.radius = hexMapRadius(std::atoi(argv[++argIdx]));
+        }
+        else if (hasValue && !std::strcmp(argv[argIdx], "--bases"))
+        {
+            params.basesNb = std::atoi(argv[++argIdx]);
+        }
+        else if (hasValue && !std::strcmp(argv[argIdx], "--density"))
+        {
+            params.resourcesDensity = std::atof(argv[++argIdx]);
+        }
+        else if (hasValue && !std::strcmp(argv[argIdx], "--eggs"))
+        {
+            params.eggsPart = std::atof(argv[++argIdx]);
+        }
+        else if (hasValue && !std::strcmp(argv[argIdx], "--seed"))
+        {
+            seed = uint32_t(std::strtoul(argv[++argIdx], nullptr, 10));
+        }
+        else if (hasValue && !std::strcmp(argv[argIdx], "-o"))
+        {
+            outputPath = argv[++argIdx];
+        }
+        else
+        {
+            std::fprintf(stderr, "Usage: %s [--radius R | --cells N] [--bases B] [--density D] [--eggs E] [--seed S] [-o file]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    Field mapField;
+    generateMap(seed, params, mapField);
+
+    std::string text;
+    appendMapInit(mapField, text);
+
+    FILE* output = outputPath ? std::fopen(outputPath, "wb") : stdout;
+    if (!output)
+    {
+        std::fprintf(stderr, "Can't open %s\n", outputPath);
+        return 1;
+    }
+    const bool isWritten = std::fwrite(text.data(), 1, text.size(), output) == text.size();
+    if (outputPath)
+    {
+        std::fclose(output);
+    }
+    if (!isWritten)
+    {
+        std::fprintf(stderr, "Can't write the map\n");
+        return 1;
+    }
+
+    std::fprintf(stderr, "radius %d: %d cells, %d bases, %d crystals, %d eggs\n", hexMapRadius(mapField.numberOfCells), mapField.numberOfCells,
+        mapField.numberOfBases, mapField.totalCrystalsNb, mapField.totalEggsNb);
+    return 0;
+}
@@ -0,0 +1,67 @@
+// Plays the bot against itself on a map in the init protocol format with the in-process simulator.
+// Usage: simulate <map file> [games number] [ants per base]
+
+#define SPRING_CHALLENGE_NO_MAIN
+#include "../main.cpp"
+#include "Simulator.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+
+using namespace SpringChallenge2023;
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::fprintf(stderr, "Usage: %s <map file> [games number] [ants per base]\n", argv[0]);
+        return 1;
+    }
+
+    const int mapFd = open(argv[1], O_RDONLY);
+    if (mapFd < 0)
+    {
+        std::fprintf(stderr, "Can't open map %s\n", argv[1]);
+        return 1;
+    }
+    std::unique_ptr<InputReader> mapInput{ new InputReader(mapFd) };
+    Field mapField;
+    const bool isMapValid = mapField.init(*mapInput);
+    close(mapFd);
+    if (!isMapValid)
+    {
+        std::fprintf(stderr, "Invalid map %s\n", argv[1]);
+        return 1;
+    }
+    mapField.calcDistances();
+
+    const int gamesNb = argc > 2 ? std::atoi(argv[2]) : 1;
+    const int antsPerBase = argc > 3 ? std::atoi(argv[3]) : 10;
+
+    Simulator simulator(mapField);
+    std::array<int, 3> results{}; // draws, wins of player 0, wins of player 1
+    long long totalTurns = 0;
+
+    const auto startTime = std::chrono::steady_clock::now();
+    for (int gameIdx = 0; gameIdx < gamesNb; gameIdx++)
+    {
+        std::unique_ptr<Game> player0 = makeSimulatedGame(mapField, false);
+        std::unique_ptr<Game> player1 = makeSimulatedGame(mapField, true);
+
+        const MatchResult result = playMatch(simulator, *player0, *player1, antsPerBase);
+        results[result.winner + 1]++;
+        totalTurns += result.turns;
+
+        if (gamesNb == 1)
+        {
+            std::printf("winner %d, crystals %d:%d, turns %d\n", result.winner, result.scores[0], result.scores[1], result.turns);
+        }
+    }
+    const double elapsedSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    std::printf("games %d: player 0 wins %d, player 1 wins %d, draws %d\n", gamesNb, results[1], results[2], results[0]);
+    std::printf("%lld turns in %.3f s, %.0f turns/s\n", totalTurns, elapsedSec, double(totalTurns) / elapsedSec);
+    return 0;
+}
@@ -0,0 +1,173 @@
+// Self-play tournament between two parameter sets of the bot on generated maps.
+// Every map is played twice with swapped sides, games run in parallel with the in-process simulator.
+// Usage: tournament [--games N] [--seed S] [--threads T] [--a key=value]... [--b key=value]...
+// keys: threshold (new lines threshold ratio), strength (beacon strength), contested (contested beacon strength)
+
+#define SPRING_CHALLENGE_NO_MAIN
+#include "../main.cpp"
+#include "MapGenerator.h"
+#include "Simulator.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace SpringChallenge2023;
+
+namespace
+{
+
+struct GameRecord
+{
+    // result for the parameter set A: 1 - win, 0 - draw, -1 - loss
+    int outcome;
+    int turns;
+    int cellsNb;
+};
+
+bool setParam(GameParams& params, const char* assignment)
+{
+    const char* value = std::strchr(assignment, '=');
+    if (!value)
+    {
+        return false;
+    }
+    const std::string key(assignment, value - assignment);
+    value++;
+
+    if (key == "threshold")
+    {
+        params.newLinesThresholdRatio = std::atof(value);
+    }
+    else if (key == "strength")
+    {
+        params.beaconStrength = std::atoi(value);
+    }
+    else if (key == "contested")
+    {
+        params.contestedBeaconStrength = std::atoi(value);
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+void printParams(const char* name, const GameParams& params)
+{
+    std::printf("%s: threshold=%g strength=%d contested=%d\n", name,
+        params.newLinesThresholdRatio, params.beaconStrength, params.contestedBeaconStrength);
+}
+
+// contest-sized map for the game index, both games of a pair get the same map
+void makeTournamentMap(uint32_t seed, int gameIdx, Field& mapField)
+{
+    const uint32_t mapSeed = seed * 1000003u + uint32_t(gameIdx / 2);
+    std::mt19937 rng{ mapSeed };
+    MapParams mapParams;
+    mapParams.radius = std::uniform_int_distribution<int>{ 4, 7 }(rng);
+    mapParams.basesNb = std::uniform_int_distribution<int>{ 1, 2 }(rng);
+    generateMap(mapSeed, mapParams, mapField);
+    mapField.calcDistances();
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    int gamesNb = 200;
+    uint32_t seed = 1;
+    int threadsNb = 0;
+    GameParams paramsA;
+    GameParams paramsB;
+
+    for (int argIdx = 1; argIdx < argc; argIdx++)
+    {
+        const bool hasValue = argIdx + 1 < argc;
+        if (hasValue && !std::strcmp(argv[argIdx], "--games"))
+        {
+            gamesNb = std::atoi(argv[++argIdx]);
+        }
+        else if (hasValue && !std::strcmp(argv[argIdx], "--seed"))
+        {
+            seed = uint32_t(std::strtoul(argv[++argIdx], nullptr, 10));
+        }
+        else if (hasValue && !std::strcmp(argv[argIdx], "--threads"))
+        {
+            threadsNb = std::atoi(argv[++argIdx]);
+        }
+        else if (hasValue && !std::strcmp(argv[argIdx], "--a") && setParam(paramsA, argv[argIdx + 1]))
+        {
+            argIdx++;
+        }
+        else if (hasValue && !std::strcmp(argv[argIdx], "--b") && setParam(paramsB, argv[argIdx + 1]))
+        {
+            argIdx++;
+        }
+        else
+        {
+            std::fprintf(stderr, "Usage: %s [--games N] [--seed S] [--threads T] [--a key=value]... [--b key=value]...\n"
+                "keys: threshold, strength, contested\n", argv[0]);
+            return 1;
+        }
+    }
+    // sides are swapped on every map
+    gamesNb += gamesNb % 2;
+
+    WorkStealingPool pool{ threadsNb };
+    std::vector<GameRecord> records(gamesNb);
+
+    const auto startTime = std::chrono::steady_clock::now();
+    pool.run(gamesNb, [&](int gameIdx, int)
+    {
+        Field mapField;
+        makeTournamentMap(seed, gameIdx, mapField);
+        Simulator simulator(mapField);
+
+        // parameter set A plays first on even games and second on odd ones
+        const bool isASecond = gameIdx % 2 != 0;
+        std::unique_ptr<Game> player0 = makeSimulatedGame(mapField, false);
+        std::unique_ptr<Game> player1 = makeSimulatedGame(mapField, true);
+        player0->setParams(isASecond ? paramsB : paramsA);
+        player1->setParams(isASecond ? paramsA : paramsB);
+
+        const MatchResult result = playMatch(simulator, *player0, *player1);
+        const int winnerA = isASecond ? 1 : 0;
+        records[gameIdx] = { result.winner == -1 ? 0 : (result.winner == winnerA ? 1 : -1), result.turns, mapField.numberOfCells };
+    });
+    const double elapsedSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+    int winsNb = 0;
+    int drawsNb = 0;
+    int lossesNb = 0;
+    long long totalTurns = 0;
+    long long totalCells = 0;
+    for (const GameRecord& record : records)
+    {
+        winsNb += record.outcome > 0;
+        drawsNb += record.outcome == 0;
+        lossesNb += record.outcome < 0;
+        totalTurns += record.turns;
+        totalCells += record.cellsNb;
+    }
+
+    // Wilson score interval for the score of A, draw counts as half of a win
+    const double z = 1.96;
+    const double n = gamesNb;
+    const double score = (winsNb + 0.5 * drawsNb) / n;
+    const double denominator = 1. + z * z / n;
+    const double center = (score + z * z / (2. * n)) / denominator;
+    const double halfWidth = z * std::sqrt(score * (1. - score) / n + z * z / (4. * n * n)) / denominator;
+
+    printParams("A", paramsA);
+    printParams("B", paramsB);
+    std::printf("games %d (%d maps, %.0f cells avg), seed %u, threads %d\n",
+        gamesNb, gamesNb / 2, double(totalCells) / n, seed, pool.threadsNb());
+    std::printf("A: wins %d, draws %d, losses %d\n", winsNb, drawsNb, lossesNb);
+    std::printf("A score %.1f%%, 95%% CI [%.1f%%, %.1f%%]\n", 100. * score, 100. * (center - halfWidth), 100. * (center + halfWidth));
+    std::printf("%.3f s, %.1f games/s, %.0f turns/s\n", elapsedSec, n / elapsedSec, double(totalTurns) / elapsedSec);
+    return 0;
+}